@@ -0,0 +1,63 @@
+"""Fixed point voltage to dBm tables for the detector firmware.
+
+Run to regenerate detector/example/src/power_lut.c from ad8319cal.py."""
+from ad8319cal import cal_table
+
+#Must match power.h
+LUT_POINTS = 129
+LUT_SHIFT = 9
+SAMPLE_FULL_SCALE = 4095*16
+VREF = 3.3
+#From parallel 50 ohm termination
+TERMINATION_DB = 3.3
+
+def interp(x, xp, fp):
+    """Linear interpolation with linear extrapolation, xp sorted."""
+    if x <= xp[0]:
+        i = 0
+    elif x >= xp[-1]:
+        i = len(xp) - 2
+    else:
+        i = 0
+        while xp[i+1] < x:
+            i += 1
+    return fp[i] + (fp[i+1] - fp[i]) * (x - xp[i]) / (xp[i+1] - xp[i])
+
+def dbm_lut(points):
+    """Table of dBm in 0.01 dB units for samples k << LUT_SHIFT, from a list
+    of (dBm, V) calibration points."""
+    points = sorted(points, key=lambda p: p[1])
+    v = [p[1] for p in points]
+    dbm = [p[0] for p in points]
+    lut = []
+    for k in range(LUT_POINTS):
+        x = VREF * (k << LUT_SHIFT) / float(SAMPLE_FULL_SCALE)
+        y = int(round(100 * (interp(x, v, dbm) + TERMINATION_DB)))
+        lut.append(max(-32768, min(32767, y)))
+    return lut
+
+def cal_luts():
+    """List of (frequency in MHz, table) sorted by frequency."""
+    return [(f, dbm_lut(cal_table[f])) for f in sorted(cal_table.keys())]
+
+def write_c(fname):
+    luts = cal_luts()
+    with open(fname, 'w') as f:
+        f.write('/*\n')
+        f.write(' * @brief Default AD8319 calibration tables\n')
+        f.write(' *\n')
+        f.write(' * @note\n')
+        f.write(' * Generated by cal_lut.py from ad8319cal.py, do not edit.\n')
+        f.write(' */\n')
+        f.write('#include "board.h"\n')
+        f.write('#include "power.h"\n\n')
+        f.write('const POWER_BAND_T power_default_bands[POWER_DEFAULT_BANDS] = {\n')
+        for freq, lut in luts:
+            f.write('\t{{{}, {{\n'.format(freq))
+            for i in range(0, len(lut), 8):
+                f.write('\t\t' + ', '.join(str(y) for y in lut[i:i+8]) + ',\n')
+            f.write('\t}},\n')
+        f.write('};\n')
+
+if __name__ == "__main__":
+    write_c('detector/example/src/power_lut.c')
@@ -1,8 +1,13 @@
 import sys
+import os
+import json
+import struct
+import time
 import serial
 import serial.tools.list_ports
 from scipy.interpolate import interp1d
 from ad8319cal import cal_table
+from cal_lut import cal_luts, interp, LUT_POINTS, LUT_SHIFT
 
 for k in cal_table.keys():
     cal_table[k] = zip(*cal_table[k])
@@ -16,6 +21,679 @@ def v_to_dbm(v, freq):
         x.append(interp1d(fy, fx, fill_value='extrapolate')(v))
     return interp1d(cal_freqs, x, fill_value='extrapolate')(freq) + 3.3 #From parallel 50 ohm termination
 
+FRAME_SYNC = '\xa5\x5a'
+FRAME_VERSION = 4
+FRAME_HDR = struct.Struct('<2sBBHHIHHHH')
+FRAME_MAX_PAYLOAD = 256
+
+#Samples have 4 fractional bits
+SAMPLE_SCALE = 16.0
+
+FRAME_SAMPLES = 1
+FRAME_ACK = 2
+FRAME_STATS = 3
+FRAME_BURST = 4
+FRAME_POWER = 5
+FRAME_SWEEP = 6
+FRAME_SOF = 7
+FRAME_PACKED = 8
+FRAME_DELTA = 9
+#Sample frames in any encoding
+SAMPLE_FRAMES = (FRAME_SAMPLES, FRAME_PACKED, FRAME_DELTA)
+
+CMD_SYNC = '\xc3'
+CMD_PING = 0
+CMD_GET_STATUS = 1
+CMD_SET_RATE = 2
+CMD_SET_AVERAGE = 3
+CMD_SET_TADJ = 4
+CMD_STREAM = 5
+CMD_SET_MODE = 6
+CMD_SET_LED = 7
+CMD_SET_SMOOTHING = 8
+CMD_SET_WINDOW = 9
+CMD_SET_TRIGGER = 10
+CMD_SET_FREQUENCY = 11
+CMD_SET_OUTPUT = 12
+CMD_WRITE_CALIB = 13
+CMD_READ_CALIB = 14
+CMD_SET_PROFILE = 15
+CMD_SET_EXT_TRIGGER = 16
+CMD_SET_SEQUENCE = 17
+CMD_LOAD_SWEEP = 18
+CMD_SET_SYNC = 19
+CMD_SET_ENCODING = 20
+
+CMD_ERRORS = {1: 'unknown command', 2: 'bad length', 3: 'bad parameter', 4: 'failed'}
+
+MODE_STREAM = 0
+MODE_STATS = 1
+MODE_BURST = 2
+MODE_EXTERNAL = 3
+MODE_SEQUENCE = 4
+MODE_SWEEP = 5
+
+SYNC_NONE = 0
+SYNC_MASTER = 1
+SYNC_SLAVE = 2
+
+#Sample frame encodings
+ENCODE_NONE = 0
+ENCODE_PACK12 = 1
+ENCODE_DELTA = 2
+
+STATUS_FIELDS = ('rate', 'max_rate', 'average', 'mode', 'flags',
+                 'overflows', 'tx_dropped', 'rx_errors', 'smoothing', 'frac_bits', 'window', 'tick_rate', 'frequency',
+                 'uid0', 'uid1', 'uid2', 'uid3', 'calib_crc', 'adc_overruns', 'dma_errors', 'block_jitter',
+                 'achieved_rate', 'profile', 'missed_triggers', 'steps_done', 'tadj_switches', 'tadj_tick',
+                 'sync', 'encoding')
+STATUS = struct.Struct('<IIHBBIIIBBxxIII4IHxxIIIIIIIIIII')
+STATS_RECORD = struct.Struct('<IHHHH')
+BURST_HDR = struct.Struct('<HHH')
+SWEEP_HDR = struct.Struct('<HHH')
+SWEEP_POINT = struct.Struct('<HHHBx')
+
+STATUS_STREAMING = 1 << 0
+STATUS_TADJ = 1 << 1
+STATUS_POWER = 1 << 2
+STATUS_CALIB = 1 << 3
+STATUS_TADJ_AUTO = 1 << 4
+
+SWEEP_EXTERNAL = 1 << 0
+SWEEP_REPEAT = 1 << 1
+SWEEP_POWER = 1 << 15
+SWEEP_INVALID_SAMPLE = 0xffff
+SWEEP_INVALID_POWER = -32768
+
+PROFILE_FAST = 1 << 0
+PROFILE_10BIT = 1 << 1
+PROFILE_BURST = 1 << 2
+
+#Frame flags, health events since the previous frame
+FLAG_ADC_OVERRUN = 1 << 0
+FLAG_OVERFLOW = 1 << 1
+FLAG_TX_DROPPED = 1 << 2
+FLAG_RX_ERROR = 1 << 3
+FLAG_DMA_ERROR = 1 << 4
+FLAG_NAMES = {FLAG_ADC_OVERRUN: 'ADC overrun', FLAG_OVERFLOW: 'capture overflow',
+              FLAG_TX_DROPPED: 'TX dropped', FLAG_RX_ERROR: 'RX error', FLAG_DMA_ERROR: 'DMA error'}
+
+CALIB_MAGIC = 0x4c414344
+CALIB_VERSION = 1
+CALIB_HDR = struct.Struct('<HHIHHhH')
+
+def _crc16_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xa001 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+_CRC16_TABLE = _crc16_table()
+
+def crc16(data, crc=0):
+    """CRC-16/ARC, as computed by the device CRC engine."""
+    for c in data:
+        crc = (crc >> 8) ^ _CRC16_TABLE[(crc ^ ord(c)) & 0xff]
+    return crc
+
+def unpack12(data, count):
+    """Samples packed two in three bytes, little-endian."""
+    samples = []
+    for i in range(count):
+        lo, hi = ord(data[3*i//2]), ord(data[3*i//2 + 1])
+        samples.append((lo | hi << 8) >> 4 if i & 1 else (lo | hi << 8) & 0xfff)
+    return samples
+
+def decode_delta(data, count):
+    """Zigzag mapped sample deltas in 7-bit groups, the first one from 0."""
+    samples = []
+    prev = pos = 0
+    for _ in range(count):
+        z = shift = 0
+        while True:
+            c = ord(data[pos])
+            pos += 1
+            z |= (c & 0x7f) << shift
+            shift += 7
+            if not c & 0x80:
+                break
+        prev += (z >> 1) ^ -(z & 1)
+        samples.append(prev)
+    return samples
+
+class Frame(object):
+    def __init__(self, ftype, seq, tick, count, payload, flags=0, index=0):
+        self.type = ftype
+        self.seq = seq
+        #32-bit device tick, ticks is the unwrapped value set by the reader
+        self.tick = tick
+        self.ticks = tick
+        self.count = count
+        self.payload = payload
+        self.flags = flags
+        #Low 16 bits of the sample index, same on detectors sharing a sample clock
+        self.index = index
+
+    def health(self):
+        """Names of the health events flagged in this frame."""
+        return [name for flag, name in sorted(FLAG_NAMES.items()) if self.flags & flag]
+
+    def samples(self):
+        """Samples in 12-bit ADC units, with the fractional bits of the
+        decimator unless packed to 12 bits."""
+        if self.type == FRAME_PACKED:
+            return [float(s) for s in unpack12(self.payload, self.count)]
+        if self.type == FRAME_DELTA:
+            return [s / SAMPLE_SCALE for s in decode_delta(self.payload, self.count)]
+        return [s / SAMPLE_SCALE for s in struct.unpack('<{}H'.format(self.count), self.payload[:2*self.count])]
+
+    def power(self):
+        """Calibrated power in dBm."""
+        return [p / 100.0 for p in struct.unpack('<{}h'.format(self.count), self.payload[:2*self.count])]
+
+    def stats(self):
+        """Window statistics as dicts. min and max are 12-bit ADC units,
+        mean and rms have the fractional bits of the decimator."""
+        records = []
+        for i in range(self.count):
+            count, lo, hi, mean, rms = STATS_RECORD.unpack_from(self.payload, i*STATS_RECORD.size)
+            records.append({'count': count, 'min': lo, 'max': hi,
+                            'mean': mean / SAMPLE_SCALE, 'rms': rms / SAMPLE_SCALE})
+        return records
+
+class BusClock(object):
+    """USB frame counter of one host controller, shared by the readers of
+    all detectors on it. The 11-bit SOF frame numbers wrap every 2.048 s,
+    they are unwrapped against the host clock, which only has to be right
+    to within a second."""
+    def __init__(self):
+        self.offset = None
+
+    def unwrap(self, number, host_time):
+        """Frame count of a SOF frame number received at host_time."""
+        ms = int(host_time * 1000)
+        if self.offset is None:
+            self.offset = number - ms
+        guess = ms + self.offset
+        count = guess + (number - guess + 1024) % 2048 - 1024
+        #Follow the drift between the host and USB clocks
+        self.offset = count - ms
+        return count
+
+#Detectors on different host controllers need a BusClock each
+BUS_CLOCK = BusClock()
+
+#SOF frames kept for the tick to USB frame mapping
+SOF_POINTS = 20
+
+class FrameReader(object):
+    """Reads frames from a detector, dropping corrupted data.
+
+    lost counts frames missing from the sequence, crc_errors counts frames
+    discarded because of a bad header or CRC. flags collects the device
+    health flags of all frames read."""
+    def __init__(self, ser, bus_clock=BUS_CLOCK):
+        self.ser = ser
+        self.bus_clock = bus_clock
+        self.sof = []
+        self.buf = ''
+        self.seq = None
+        self.lost = 0
+        self.crc_errors = 0
+        self.flags = 0
+        self.last_tick = None
+
+    def reset(self):
+        """Discard buffered data, the next frame starts a new sequence."""
+        self.ser.reset_input_buffer()
+        self.buf = ''
+        self.seq = None
+
+    def _fill(self, n):
+        while len(self.buf) < n:
+            data = self.ser.read(max(n - len(self.buf), self.ser.in_waiting))
+            if not data:
+                return False
+            self.buf += data
+        return True
+
+    def read_frame(self):
+        """Read the next valid frame. Returns None on timeout."""
+        while True:
+            i = self.buf.find(FRAME_SYNC)
+            if i < 0:
+                #Keep a possible first sync byte
+                self.buf = self.buf[-1:]
+                if not self._fill(len(self.buf) + 1):
+                    return None
+                continue
+            self.buf = self.buf[i:]
+            if not self._fill(FRAME_HDR.size):
+                return None
+            sync, ver, ftype, seq, length, tick, count, flags, index, crc = FRAME_HDR.unpack_from(self.buf)
+            if ver != FRAME_VERSION or length > FRAME_MAX_PAYLOAD:
+                #Not a frame header, hunt for the next sync word
+                self.crc_errors += 1
+                self.buf = self.buf[1:]
+                continue
+            size = FRAME_HDR.size + length
+            if not self._fill(size):
+                return None
+            hdr = self.buf[:FRAME_HDR.size - 2] + '\x00\x00'
+            if crc16(self.buf[FRAME_HDR.size:size], crc16(hdr)) != crc:
+                self.crc_errors += 1
+                self.buf = self.buf[1:]
+                continue
+            payload = self.buf[FRAME_HDR.size:size]
+            self.buf = self.buf[size:]
+            if self.seq is not None:
+                self.lost += (seq - self.seq - 1) & 0xffff
+            self.seq = seq
+            self.flags |= flags
+            frame = Frame(ftype, seq, tick, count, payload, flags, index)
+            self._unwrap(frame)
+            if ftype == FRAME_SOF:
+                self._sof(frame)
+            return frame
+
+    def _unwrap(self, frame):
+        #Ticks wrap every 2**32 ticks, frames may refer to slightly earlier times
+        if self.last_tick is not None:
+            delta = (frame.tick - self.last_tick[0] + 2**31) % 2**32 - 2**31
+            frame.ticks = self.last_tick[1] + delta
+        self.last_tick = (frame.tick, frame.ticks)
+
+    def _sof(self, frame):
+        number = struct.unpack_from('<H', frame.payload)[0]
+        self.sof.append((self.bus_clock.unwrap(number, time.time()), frame.ticks))
+        del self.sof[:-SOF_POINTS]
+
+    def bus_time(self, frame):
+        """Time of a frame in seconds on the USB frame clock, comparable
+        between detectors on the same host controller. None until two SOF
+        frames were read, they are sent while streaming."""
+        if len(self.sof) < 2:
+            return None
+        (f0, t0), (f1, t1) = self.sof[0], self.sof[-1]
+        #Device tick rate measured against the USB frame clock
+        return (f1 + float(frame.ticks - t1) * (f1 - f0) / (t1 - t0)) / 1000.0
+
+    def read_data_frame(self):
+        """Read the next sample or power frame."""
+        while True:
+            frame = self.read_frame()
+            if frame is not None and (frame.type in SAMPLE_FRAMES or frame.type == FRAME_POWER):
+                return frame
+
+    def read_samples(self):
+        """Read the next sample frame. Returns a list of samples in 12-bit ADC units."""
+        while True:
+            frame = self.read_frame()
+            if frame is not None and frame.type in SAMPLE_FRAMES:
+                return frame.samples()
+
+    def read_power(self):
+        """Read the next power frame. Returns a list of power in dBm."""
+        while True:
+            frame = self.read_frame()
+            if frame is not None and frame.type == FRAME_POWER:
+                return frame.power()
+
+    def read_stats(self):
+        """Read the next statistics frame. Returns a list of window records."""
+        while True:
+            frame = self.read_frame()
+            if frame is not None and frame.type == FRAME_STATS:
+                return frame.stats()
+
+    def read_burst(self):
+        """Read the next triggered burst. Returns (samples, pre) where samples
+        are 12-bit ADC results and samples[pre] is the trigger sample."""
+        samples = []
+        while True:
+            frame = self.read_frame()
+            if frame is None or frame.type != FRAME_BURST:
+                continue
+            offset, total, pre = BURST_HDR.unpack_from(frame.payload)
+            if offset == 0:
+                samples = []
+            elif offset != len(samples):
+                #Lost a piece, wait for the start of the next burst
+                samples = []
+                continue
+            samples.extend(struct.unpack_from('<{}H'.format(frame.count), frame.payload, BURST_HDR.size))
+            if len(samples) == total:
+                return samples, pre
+
+    def read_sweep(self):
+        """Read the next sweep result. Returns a list with one entry per
+        point, in 12-bit ADC units or in dBm with power output, None for
+        points whose timing did not fit the sample rate."""
+        results = []
+        while True:
+            frame = self.read_frame()
+            if frame is None or frame.type != FRAME_SWEEP:
+                continue
+            offset, total, flags = SWEEP_HDR.unpack_from(frame.payload)
+            if offset != len(results):
+                #Lost a piece, wait for the start of the next sweep
+                results = []
+                if offset != 0:
+                    continue
+            if flags & SWEEP_POWER:
+                values = struct.unpack_from('<{}h'.format(frame.count), frame.payload, SWEEP_HDR.size)
+                results.extend(None if v == SWEEP_INVALID_POWER else v / 100.0 for v in values)
+            else:
+                values = struct.unpack_from('<{}H'.format(frame.count), frame.payload, SWEEP_HDR.size)
+                results.extend(None if v == SWEEP_INVALID_SAMPLE else v / SAMPLE_SCALE for v in values)
+            if len(results) == total:
+                return results
+
+def _index_ahead(a, b):
+    #Sample indices are 16 bits, True if a is later than b
+    return 0 < (a - b) % 2**16 < 2**15
+
+def read_aligned(readers):
+    """Read sample or power frames from detectors sharing a sample clock,
+    see Detector.set_sync(). Returns one frame per reader, all covering the
+    same conversions."""
+    frames = [r.read_data_frame() for r in readers]
+    while True:
+        lead = frames[0].index
+        for frame in frames[1:]:
+            if _index_ahead(frame.index, lead):
+                lead = frame.index
+        for i, r in enumerate(readers):
+            while _index_ahead(lead, frames[i].index):
+                frames[i] = r.read_data_frame()
+        #A lost frame moves the lead, try again
+        if all(frame.index == lead for frame in frames):
+            return frames
+
+def calib_image(luts, offset=0):
+    """Device calibration image from a list of (frequency in MHz, table)
+    sorted by frequency. offset is added to all bands in dB."""
+    bands = ''.join(struct.pack('<H{}h'.format(LUT_POINTS), f, *lut) for f, lut in luts)
+    body = CALIB_HDR.pack(0, CALIB_VERSION, CALIB_MAGIC, LUT_POINTS, len(luts),
+                          int(round(offset*100)), 0)[2:] + bands
+    return struct.pack('<H', crc16(body)) + body
+
+def parse_calib_image(image):
+    """Returns (list of (frequency in MHz, table), offset in dB)."""
+    crc, ver, magic, points, nbands, offset, _ = CALIB_HDR.unpack_from(image)
+    if crc16(image[2:]) != crc or magic != CALIB_MAGIC or ver != CALIB_VERSION:
+        raise ValueError('Invalid calibration image')
+    luts = []
+    band = struct.Struct('<H{}h'.format(points))
+    for i in range(nbands):
+        v = band.unpack_from(image, CALIB_HDR.size + i*band.size)
+        luts.append((v[0], list(v[1:])))
+    return luts, offset / 100.0
+
+def calib_to_dbm(luts, offset, y, freq):
+    """Convert a sample in 12-bit ADC units to dBm the same way the device
+    does, from (luts, offset) as returned by Detector.read_calib."""
+    if not luts:
+        luts = cal_luts()
+    x = y * SAMPLE_SCALE / (1 << LUT_SHIFT)
+    index = range(LUT_POINTS)
+    freqs = [f for f, lut in luts]
+    dbm = [interp(x, index, lut) / 100.0 for f, lut in luts]
+    freq = min(max(freq / 1e6, freqs[0]), freqs[-1])
+    return interp(freq, freqs, dbm) + offset
+
+class CommandError(Exception):
+    pass
+
+class Detector(FrameReader):
+    """Frame reader that can also send commands to the detector."""
+    def __init__(self, ser, bus_clock=BUS_CLOCK):
+        FrameReader.__init__(self, ser, bus_clock)
+        self.queued = []
+        self.tick_rate = None
+
+    def read_frame(self):
+        if self.queued:
+            return self.queued.pop(0)
+        return FrameReader.read_frame(self)
+
+    def reset(self):
+        FrameReader.reset(self)
+        self.queued = []
+
+    def command(self, op, payload='', retries=20):
+        """Send a command and wait for its acknowledge. Returns the reply."""
+        msg = struct.pack('<cBH', CMD_SYNC, op, len(payload)) + payload
+        self.ser.write(msg + struct.pack('<H', crc16(msg)))
+        for _ in range(retries):
+            frame = FrameReader.read_frame(self)
+            if frame is None:
+                continue
+            if frame.type != FRAME_ACK:
+                #Keep sample frames for read_samples
+                self.queued.append(frame)
+                continue
+            ack_op, result = struct.unpack_from('<BB', frame.payload)
+            if ack_op != op:
+                continue
+            if result != 0:
+                raise CommandError(CMD_ERRORS.get(result, 'error {}'.format(result)))
+            return frame.payload[2:]
+        raise CommandError('no acknowledge')
+
+    def ping(self):
+        self.command(CMD_PING)
+
+    def status(self):
+        status = dict(zip(STATUS_FIELDS, STATUS.unpack_from(self.command(CMD_GET_STATUS))))
+        #Same format as the USB serial number
+        status['uid'] = ''.join('{:08X}'.format(status.pop('uid{}'.format(i))) for i in range(4))
+        self.tick_rate = status['tick_rate']
+        return status
+
+    def seconds(self, frame):
+        """Device time of a frame in seconds."""
+        if self.tick_rate is None:
+            self.status()
+        return float(frame.ticks) / self.tick_rate
+
+    def set_sample_rate(self, rate):
+        """Set ADC sample rate in Hz. Returns the rate set by the device."""
+        return struct.unpack('<I', self.command(CMD_SET_RATE, struct.pack('<I', int(rate))))[0]
+
+    def set_profile(self, fast=False, bits10=False, burst=False):
+        """Select the ADC acquisition profile. fast raises the ADC clock, bits10
+        selects 10-bit conversions and burst runs conversions back to back
+        at the fastest rate. Returns the nominal sample rate, status()
+        reports the achieved rate."""
+        profile = (PROFILE_FAST if fast else 0) | (PROFILE_10BIT if bits10 else 0) | \
+                  (PROFILE_BURST if burst else 0)
+        return struct.unpack('<I', self.command(CMD_SET_PROFILE, chr(profile)))[0]
+
+    def set_average(self, n):
+        """Set decimation ratio, conversions averaged per sample. Returns the ratio used."""
+        return struct.unpack('<H', self.command(CMD_SET_AVERAGE, struct.pack('<H', int(n))))[0]
+
+    def set_smoothing(self, shift):
+        """Set IIR smoother time constant to 2**shift samples, 0 disables it.
+        Returns the shift used."""
+        return ord(self.command(CMD_SET_SMOOTHING, chr(shift)))
+
+    def set_window(self, n):
+        """Set statistics window in conversions. Returns the window used."""
+        return struct.unpack('<I', self.command(CMD_SET_WINDOW, struct.pack('<I', int(n))))[0]
+
+    def set_trigger(self, level, falling=False, pre=256, post=768):
+        """Set burst trigger level in 12-bit ADC units, edge and number of
+        samples kept before and from the trigger on."""
+        self.command(CMD_SET_TRIGGER, struct.pack('<HBxHH', int(level), bool(falling), pre, post))
+
+    def set_ext_trigger(self, falling=False, settle=0.0):
+        """Set the external trigger edge and the delay in seconds from the
+        edge to the first conversion, up to 65 ms. In MODE_EXTERNAL each edge
+        gives one sample averaged over set_average() conversions, stamped
+        with the tick of the edge."""
+        self.command(CMD_SET_EXT_TRIGGER, struct.pack('<BxH', bool(falling), int(round(settle*1e6))))
+
+    def set_sequence(self, settle, samples, steps=0):
+        """Set the SCT sequencer timeline for MODE_SEQUENCE. Each step raises
+        the sync output, waits settle seconds and then takes samples
+        conversions at the sample rate, steps=0 runs until stopped. Set the
+        average to samples for one sample per step."""
+        self.command(CMD_SET_SEQUENCE, struct.pack('<IHxxI', int(round(settle*1e6)), samples, steps))
+
+    def load_sweep(self, points, external=False, repeat=False):
+        """Store a sweep list for MODE_SWEEP. points is a list of (settle,
+        samples, tadj, freq) with settle in seconds up to 65 ms, samples
+        conversions averaged, tadj True for the 500 ohm resistor and freq
+        in Hz for the calibration. tadj is not used while T_ADJ follows the
+        frequency. Each point starts with the sequencer sync
+        output, or waits for the external trigger edge if external is set.
+        The results are read with read_sweep()."""
+        flags = (SWEEP_EXTERNAL if external else 0) | (SWEEP_REPEAT if repeat else 0)
+        data = struct.pack('<Hxx', flags)
+        for settle, samples, tadj, freq in points:
+            data += SWEEP_POINT.pack(int(round(settle*1e6)), samples, int(round(freq/1e6)), bool(tadj))
+        self.command(CMD_LOAD_SWEEP, data)
+
+    def set_sync(self, role):
+        """Share the sample clock between detectors. The SYNC_MASTER drives
+        its clock on PIO0_18, every SYNC_SLAVE converts on the rising edges
+        at its PIO0_2 and keeps its own rate only for block timing, so set
+        the same rate and average on all of them. Frames of the same
+        conversions then carry the same index, see read_aligned(). Stop the
+        master stream, set up the slaves and then start the master."""
+        self.command(CMD_SET_SYNC, chr(role))
+
+    def set_encoding(self, mode):
+        """Select the sample frame encoding. ENCODE_PACK12 sends whole
+        12-bit samples in 3 bytes per 2, ENCODE_DELTA sends lossless
+        differences in 1 to 3 bytes each. Frames that would not get shorter
+        are sent as plain samples, power output is never encoded."""
+        self.command(CMD_SET_ENCODING, chr(mode))
+
+    def set_frequency(self, freq):
+        """Set operating frequency in Hz for the device calibration and the
+        automatic T_ADJ selection."""
+        self.command(CMD_SET_FREQUENCY, struct.pack('<H', int(round(freq/1e6))))
+
+    def set_power_output(self, enable):
+        """Send calibrated power in dBm instead of samples."""
+        self.command(CMD_SET_OUTPUT, chr(bool(enable)))
+
+    def write_calib(self, luts=None, offset=0):
+        """Store a calibration in the device EEPROM. luts defaults to the
+        tables from ad8319cal.py, an empty list selects the built in tables."""
+        if luts is None:
+            luts = cal_luts()
+        self.command(CMD_WRITE_CALIB, calib_image(luts, offset))
+
+    def read_calib(self):
+        """Read back the calibration in use. Returns (luts, offset)."""
+        image = ''
+        while True:
+            data = self.command(CMD_READ_CALIB, struct.pack('<HH', len(image), 240))
+            if not data:
+                break
+            image += data
+        return parse_calib_image(image)
+
+    def set_tadj(self, high):
+        """Select T_ADJ resistor, 500 ohm if high else 8.2k. Turns off the
+        automatic selection."""
+        self.command(CMD_SET_TADJ, chr(bool(high)))
+
+    def set_tadj_auto(self):
+        """Select T_ADJ from the operating frequency, 500 ohm from 5.3 GHz
+        up. This is the default. Conversions taken while T_ADJ settles are
+        dropped, status() logs the tick of the last switch."""
+        self.command(CMD_SET_TADJ, chr(2))
+
+    def set_streaming(self, enable):
+        self.command(CMD_STREAM, chr(bool(enable)))
+        if not enable:
+            self.queued = []
+
+    def set_mode(self, mode):
+        self.command(CMD_SET_MODE, chr(mode))
+
+    def set_led(self, on):
+        self.command(CMD_SET_LED, chr(bool(on)))
+
+def open_port(dev):
+    ser = serial.Serial(
+        port=dev,
+        baudrate=1e6,
+        parity=serial.PARITY_NONE,
+        stopbits=serial.STOPBITS_TWO,
+        bytesize=serial.EIGHTBITS,
+        timeout=0.1
+    )
+    if not ser.isOpen():
+        raise Exception('Opening serial port {} failed.'.format(dev))
+    return ser
+
+def find_detectors():
+    """Open all connected detectors and query the status of each once.
+    Returns a dict of UID to (Detector, status)."""
+    found = {}
+    for dev, name, desc in serial.tools.list_ports.comports():
+        if 'VID:PID=1FC9:0083' in desc:
+            det = Detector(open_port(dev))
+            det.reset()
+            status = det.status()
+            found[status['uid']] = (det, status)
+    return found
+
+class Registry(object):
+    """Persistent map of detector UID to role and cached calibration, so
+    that the same sensor always gets the same role regardless of the port
+    enumeration order."""
+    def __init__(self, path='sensors.json'):
+        self.path = path
+        self.sensors = {}
+        if os.path.exists(path):
+            with open(path) as f:
+                self.sensors = json.load(f)
+
+    def save(self):
+        with open(self.path, 'w') as f:
+            json.dump(self.sensors, f, indent=1, sort_keys=True)
+
+    def assign(self, found, roles):
+        """Give each role in roles a detector from find_detectors. Known UIDs
+        keep their role, new UIDs take the free roles in sorted UID order.
+        Returns a dict of role to (Detector, status)."""
+        taken = {}
+        for uid in sorted(found):
+            role = self.sensors.get(uid, {}).get('role')
+            if role in roles and role not in taken:
+                taken[role] = uid
+        free = [r for r in roles if r not in taken]
+        for uid in sorted(found):
+            if uid in taken.values() or not free:
+                continue
+            taken[free.pop(0)] = uid
+        for role, uid in taken.items():
+            self.sensors.setdefault(uid, {})['role'] = role
+        self.save()
+        return dict((role, found[uid]) for role, uid in taken.items())
+
+    def calibration(self, det, status):
+        """Calibration (luts, offset) of a detector. Read from the device only
+        when the cached copy does not match the device calibration CRC."""
+        entry = self.sensors.setdefault(status['uid'], {})
+        cal = entry.get('calib')
+        if cal is None or cal['crc'] != status['calib_crc']:
+            luts, offset = det.read_calib()
+            cal = {'crc': status['calib_crc'], 'luts': luts, 'offset': offset}
+            entry['calib'] = cal
+            self.save()
+        return [(f, lut) for f, lut in cal['luts']], cal['offset']
+
 if __name__ == "__main__":
     if len(sys.argv) != 2:
         print "Give frequency in GHz as argument"
@@ -24,46 +702,23 @@ if __name__ == "__main__":
     if freq < 0 or freq > 10e9:
         print "Frequency out of range 0 < freq < 10"
         exit()
-    ports = serial.tools.list_ports.comports()
-    ser = None
-    for dev, name, desc in ports:
-        if 'VID:PID=1FC9:0083' in desc:
-            try:
-                ser = serial.Serial(
-                    port=dev,
-                    baudrate=1e6,
-                    parity=serial.PARITY_NONE,
-                    stopbits=serial.STOPBITS_TWO,
-                    bytesize=serial.EIGHTBITS,
-                    timeout=0.1
-                )
-                if not ser.isOpen():
-                    raise Exception
-            except:
-                print 'Opening serial port {} failed.'.format(dev)
-                raise
-    if ser == None:
+    found = find_detectors()
+    if not found:
         raise Exception("Unable to find device")
 
-    #Set T_ADJ
-    if freq >= 5.3e9:
-        #500 ohm if f > 5.3 GHz
-        ser.write('\xf1')
-    else:
-        #8.2k if f < 5.3 GHz
-        ser.write('\xf0')
+    uid = sorted(found)[0]
+    det = found[uid][0]
+    print 'Using detector {}'.format(uid)
+    #Set T_ADJ, 500 ohm if f > 5.3 GHz, 8.2k if f < 5.3 GHz
+    det.set_tadj(freq >= 5.3e9)
+    #Convert to dBm on the device
+    det.set_frequency(freq)
+    det.set_power_output(True)
 
     while True:
         try:
-            x = ord(ser.read(1))
-            if x != 0xFF:
-                continue
-            x = map(ord,ser.read(2))
-            if x[0] & 0xF0 != 0x00:
-                #Not synchronized
-                continue
-            y = ((x[0] & 0x0F) << 8) | x[1]
-            print v_to_dbm(3.3*y/4095.0, freq)
+            for p in det.read_power():
+                print p
         except serial.serialutil.SerialException:
             continue
         except OSError:
@@ -71,3 +726,7 @@ if __name__ == "__main__":
         except KeyboardInterrupt:
             print "Exiting"
             break
+    status = det.status()
+    print 'ADC overruns {adc_overruns}, capture overflows {overflows}, TX dropped {tx_dropped}, ' \
+          'RX errors {rx_errors}, DMA errors {dma_errors}'.format(**status)
+    print 'Worst block interval jitter {:.1f} us'.format(1e6 * status['block_jitter'] / status['tick_rate'])
@@ -70,10 +70,14 @@ extern "C"
 #define USB_STACK_MEM_BASE      0x20004000
 #define USB_STACK_MEM_SIZE      0x0800
 
+/* String descriptor index and length of the serial number */
+#define USB_SERIAL_STRING_IDX   0x03
+#define USB_SERIAL_STRING_LEN   32
+
 /* USB descriptor arrays defined *_desc.c file */
 extern const uint8_t USB_DeviceDescriptor[];
 extern uint8_t USB_FsConfigDescriptor[];
-extern const uint8_t USB_StringDescriptor[];
+extern uint8_t USB_StringDescriptor[];
 extern const uint8_t USB_DeviceQualifier[];
 
 /**
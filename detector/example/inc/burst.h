@@ -0,0 +1,98 @@
+/*
+ * @brief Triggered burst capture
+ *
+ * @note
+ * Results are copied into a circular history buffer while armed. The first
+ * threshold crossing in the selected direction freezes the pre-trigger
+ * samples before it and collects the post-trigger samples after it. The
+ * frozen burst is then read out in BURST_FRAME_T pieces and the capture is
+ * armed again.
+ */
+
+#ifndef __BURST_H_
+#define __BURST_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define BURST_MAX_SAMPLES       4096	/* History buffer, must be a power of 2 */
+#define BURST_FRAME_SAMPLES     120		/* Samples per BURST_FRAME_T */
+#define BURST_DEFAULT_LEVEL     2048
+#define BURST_DEFAULT_PRE       256
+#define BURST_DEFAULT_POST      768
+
+/**
+ * Burst piece header
+ */
+typedef struct BURST_HDR {
+	uint16_t offset;		/* Index of the first sample of this piece */
+	uint16_t total;			/* Samples in the whole burst */
+	uint16_t pre;			/* Samples before the trigger sample */
+} BURST_HDR_T;
+
+/**
+ * Burst piece, 12-bit results
+ */
+typedef struct BURST_FRAME {
+	BURST_HDR_T hdr;
+	uint16_t samples[BURST_FRAME_SAMPLES];
+} BURST_FRAME_T;
+
+/**
+ * @brief	Configure the trigger and burst length
+ * @param	level	: Trigger level as a 12-bit result
+ * @param	falling	: true to trigger on a downward crossing
+ * @param	pre		: Samples kept before the trigger
+ * @param	post	: Samples kept from the trigger on, at least 1
+ * @return	false if pre + post does not fit BURST_MAX_SAMPLES
+ * @note	Takes effect on the next burst_arm().
+ */
+bool burst_setup(uint16_t level, bool falling, uint32_t pre, uint32_t post);
+
+/**
+ * @brief	Discard any burst and wait for a new trigger
+ * @return	Nothing
+ */
+void burst_arm(void);
+
+/**
+ * @brief	Stop waiting for a trigger
+ * @return	Nothing
+ */
+void burst_disarm(void);
+
+/**
+ * @brief	Feed raw ADC results to the burst capture
+ * @param	raw		: Raw ADC data register words
+ * @param	len		: Number of words in raw
+ * @param	tick	: StopWatch tick of the last word in raw
+ * @return	Nothing
+ */
+void burst_process(const uint32_t *raw, uint32_t len, uint32_t tick);
+
+/**
+ * @brief	Read the next piece of a completed burst
+ * @param	frm		: Piece to fill in
+ * @param	tick	: StopWatch tick of the trigger sample
+ * @return	Number of samples in the piece, 0 if no burst is ready
+ * @note	The capture is armed again after the last piece.
+ */
+uint32_t burst_read(BURST_FRAME_T *frm, uint32_t *tick);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BURST_H_ */
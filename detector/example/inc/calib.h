@@ -0,0 +1,98 @@
+/*
+ * @brief Calibration storage in EEPROM
+ *
+ * @note
+ * A calibration image is a CALIB_HDR_T followed by the power bands. The
+ * same image is uploaded by the host, stored at the start of the EEPROM
+ * and cached in RAM at boot. Without a valid image the built in bands are
+ * used.
+ */
+
+#ifndef __CALIB_H_
+#define __CALIB_H_
+
+#include "board.h"
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define CALIB_MAGIC             0x4C414344	/* "DCAL" */
+#define CALIB_VERSION           1
+#define CALIB_EEPROM_ADDR       0
+#define CALIB_MAX_BANDS         12
+#define CALIB_MAX_SIZE          (sizeof(CALIB_HDR_T) + CALIB_MAX_BANDS * sizeof(POWER_BAND_T))
+
+/**
+ * Calibration image header, all fields little-endian
+ */
+typedef struct CALIB_HDR {
+	uint16_t crc;			/* CRC-16/ARC of the image after this field */
+	uint16_t version;		/* CALIB_VERSION */
+	uint32_t magic;			/* CALIB_MAGIC */
+	uint16_t points;		/* POWER_LUT_POINTS */
+	uint16_t bands;			/* Bands following, 0 to use the built in bands */
+	int16_t offset;			/* Power offset in 0.01 dB */
+	uint16_t reserved;
+} CALIB_HDR_T;
+
+/**
+ * Result codes
+ */
+typedef enum CALIB_RESULT {
+	CALIB_OK = 0,
+	CALIB_ERR_INVALID,		/* Image header, size, CRC or bands are wrong */
+	CALIB_ERR_EEPROM,		/* EEPROM write or verify failed */
+} CALIB_RESULT_T;
+
+/**
+ * @brief	Load the calibration from EEPROM into RAM and apply it
+ * @return	Nothing
+ */
+void calib_init(void);
+
+/**
+ * @brief	Store and apply a new calibration image
+ * @param	image	: Calibration image
+ * @param	len		: Image length in bytes
+ * @return	CALIB_OK or CALIB_ERR_*
+ * @note	The image is checked before anything is written.
+ */
+CALIB_RESULT_T calib_write(const uint8_t *image, uint32_t len);
+
+/**
+ * @brief	Read back part of the active calibration image
+ * @param	offset	: Byte offset into the image
+ * @param	buf		: Destination
+ * @param	len		: Bytes wanted
+ * @return	Bytes copied, 0 past the end of the image
+ */
+uint32_t calib_read(uint32_t offset, uint8_t *buf, uint32_t len);
+
+/**
+ * @brief	Check if a stored calibration is in use
+ * @return	true if the EEPROM image is active, false for the built in bands
+ */
+bool calib_is_stored(void);
+
+/**
+ * @brief	Get the CRC of the active calibration image
+ * @return	Image CRC, lets the host check a cached copy without reading it
+ */
+uint16_t calib_get_crc(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CALIB_H_ */
@@ -0,0 +1,127 @@
+/*
+ * @brief DMA ping-pong capture of ADC results
+ *
+ * @note
+ * Every sequence A conversion triggers one DMA transfer of the global data
+ * register into the active sample block. Two blocks alternate, so the CPU
+ * is only woken once per completed block. Each block is stamped with the
+ * StopWatch tick at its completion.
+ */
+
+#ifndef __CAPTURE_H_
+#define __CAPTURE_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define CAPTURE_DMA_CH          DMA_CH14	/* Channel without a peripheral request */
+#define CAPTURE_BLOCK_MAX       128			/* Maximum samples per block */
+#define CAPTURE_BLOCK_RATE      20			/* Preferred completed blocks per second */
+
+/**
+ * @brief	Initialize the DMA controller for ADC capture
+ * @return	Nothing
+ */
+void capture_init(void);
+
+/**
+ * @brief	Start filling sample blocks
+ * @param	len	: Samples per block, 1 to CAPTURE_BLOCK_MAX
+ * @return	Nothing
+ * @note	Any blocks not yet released are discarded.
+ */
+void capture_start(uint32_t len);
+
+/**
+ * @brief	Start filling a limited number of sample blocks
+ * @param	len		: Samples per block, 1 to CAPTURE_BLOCK_MAX
+ * @param	blocks	: Blocks to fill before the DMA stops, 0 for no limit
+ * @return	Nothing
+ * @note	Conversions after the last block are not transferred, so they
+ * cannot overwrite a block that is still being processed.
+ */
+void capture_start_blocks(uint32_t len, uint32_t blocks);
+
+/**
+ * @brief	Stop filling sample blocks
+ * @return	Nothing
+ */
+void capture_stop(void);
+
+/**
+ * @brief	Tell capture whether blocks complete at the nominal rate
+ * @param	enable	: true if conversions are paced by the own sample clock
+ * @return	Nothing
+ * @note	The block jitter is only measured while enabled. Triggered,
+ * sequenced and slave conversions leave gaps between blocks that would
+ * show as jitter.
+ */
+void capture_set_free_running(bool enable);
+
+/**
+ * @brief	Get the oldest completed sample block
+ * @return	Pointer to raw SEQA_GDAT words, or NULL if no block is ready
+ * @note	Restarts capture after a DMA error. The block holds
+ * capture_block_len() samples and stays valid until capture_release_block()
+ * is called.
+ */
+const uint32_t *capture_get_block(void);
+
+/**
+ * @brief	Get the timestamp of the block from capture_get_block()
+ * @return	StopWatch tick latched when the block completed, right after its
+ * last conversion
+ */
+uint32_t capture_block_tick(void);
+
+/**
+ * @brief	Get the sample index of the block from capture_get_block()
+ * @return	Conversions since capture_start() up to and including the last
+ * one of the block
+ * @note	Detectors sharing a sample clock that were started before the
+ * first clock edge give the same index for the same conversion.
+ */
+uint32_t capture_block_index(void);
+
+/**
+ * @brief	Return the block from capture_get_block() to the DMA
+ * @return	Nothing
+ */
+void capture_release_block(void);
+
+/**
+ * @brief	Get the number of samples in each block
+ * @return	Samples per block
+ */
+uint32_t capture_block_len(void);
+
+/**
+ * @brief	Get the sample rate achieved by the ADC
+ * @return	Sample rate in Hz, measured between the last two completed
+ * blocks, 0 before two blocks completed
+ */
+uint32_t capture_measured_rate(void);
+
+/**
+ * @brief	Get the number of blocks overwritten before they were released
+ * @return	Overflow count since capture_init()
+ */
+uint32_t capture_overflows(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_H_ */
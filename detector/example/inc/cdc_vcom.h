@@ -33,6 +33,7 @@
 #define __CDC_VCOM_H_
 
 #include "app_usbd_cfg.h"
+#include "spsc.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -46,10 +47,20 @@ extern "C"
 #define VCOM_RX_BUF_SZ      512
 #define VCOM_TX_CONNECTED   _BIT(8)		/* connection state is for both RX/Tx */
 #define VCOM_TX_BUSY        _BIT(0)
+#define VCOM_TX_FLUSH       _BIT(1)		/* drop queued packets up to tx_flush */
 #define VCOM_RX_DONE        _BIT(0)
 #define VCOM_RX_BUF_FULL    _BIT(1)
 #define VCOM_RX_BUF_QUEUED  _BIT(2)
 #define VCOM_RX_DB_QUEUED   _BIT(3)
+#define VCOM_TX_QUEUE_LEN   16			/* Queued IN packets, must be a power of 2 */
+
+/**
+ * Structure holding one queued bulk IN packet
+ */
+typedef struct VCOM_TX_PKT {
+	uint32_t len;
+	uint8_t data[USB_FS_MAX_BULK_PACKET];
+} VCOM_TX_PKT_T;
 
 /**
  * Structure containing Virtual Comm port control data
@@ -62,6 +73,9 @@ typedef struct VCOM_DATA {
 	uint16_t rx_count;
 	volatile uint16_t tx_flags;
 	volatile uint16_t rx_flags;
+	SPSC_RING_T tx_ring;	/* Main loop adds, USB interrupt sends */
+	uint32_t tx_flush;		/* ring head when the queue was dropped */
+	uint32_t tx_dropped;
 } VCOM_DATA_T;
 
 /**
@@ -78,6 +92,14 @@ extern VCOM_DATA_T g_vCOM;
  */
 ErrorCode_t vcom_init (USBD_HANDLE_T hUsb, USB_CORE_DESCS_T *pDesc, USBD_API_INIT_PARAM_T *pUsbParam);
 
+/**
+ * @brief	USB bus reset event handler
+ * @param	hUsb	: Handle to the USB device stack
+ * @return	LPC_OK
+ * @note	Drops all queued packets, a bus reset aborts any IN transfer.
+ */
+ErrorCode_t vcom_usb_reset(USBD_HANDLE_T hUsb);
+
 /**
  * @brief	Virtual com port buffered read routine
  * @param	pBuf	: Pointer to buffer where read data should be copied
@@ -112,10 +134,29 @@ static INLINE uint32_t vcom_connected(void) {
  * @brief	Virtual com port write routine
  * @param	pBuf	: Pointer to buffer to be written
  * @param	buf_len	: Length of the buffer passed
- * @return	Number of bytes written
+ * @return	Number of bytes queued, either buf_len or 0
+ * @note	The data is split into bulk packets and queued. If the queue
+ * cannot hold all of it nothing is queued and the bytes are added to the
+ * dropped count, so a write is never truncated.
  */
 uint32_t vcom_write (uint8_t *pBuf, uint32_t buf_len);
 
+/**
+ * @brief	Get free space in the transmit queue
+ * @return	Number of bulk packets that can be queued
+ */
+static INLINE uint32_t vcom_tx_free(void) {
+	return spsc_free(&g_vCOM.tx_ring);
+}
+
+/**
+ * @brief	Get the number of bytes dropped because the transmit queue was full
+ * @return	Dropped byte count, only cleared by reset
+ */
+static INLINE uint32_t vcom_tx_dropped(void) {
+	return g_vCOM.tx_dropped;
+}
+
 /**
  * @}
  */
@@ -0,0 +1,193 @@
+/*
+ * @brief Host command protocol
+ *
+ * @note
+ * Commands are sent as a CMD_HDR_T header, len payload bytes and a
+ * CRC-16/ARC over header and payload, little-endian. Every command that
+ * passes the CRC check is answered with a STREAM_TYPE_ACK frame holding a
+ * CMD_ACK_T followed by the command specific reply.
+ */
+
+#ifndef __COMMAND_H_
+#define __COMMAND_H_
+
+#include "board.h"
+#include "calib.h"
+#include "ident.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define CMD_SYNC                0xC3
+#define CMD_MAX_PAYLOAD         CALIB_MAX_SIZE	/* Largest command is a calibration image */
+
+/**
+ * Command header
+ */
+typedef struct CMD_HDR {
+	uint8_t sync;			/* CMD_SYNC */
+	uint8_t op;				/* CMD_OP_* */
+	uint16_t len;			/* Payload length in bytes */
+} CMD_HDR_T;
+
+/**
+ * Command codes, payload and reply layout in the comments
+ */
+typedef enum CMD_OP {
+	CMD_OP_PING = 0,		/* - */
+	CMD_OP_GET_STATUS,		/* - / CMD_STATUS_T */
+	CMD_OP_SET_RATE,		/* uint32_t Hz / uint32_t Hz programmed */
+	CMD_OP_SET_AVERAGE,		/* uint16_t ratio / uint16_t ratio used */
+	CMD_OP_SET_TADJ,		/* uint8_t 0 for 8.2k, 1 for 500 ohm, 2 to follow the frequency */
+	CMD_OP_STREAM,			/* uint8_t 1 to start, 0 to stop */
+	CMD_OP_SET_MODE,		/* uint8_t MEASURE_MODE_* */
+	CMD_OP_SET_LED,			/* uint8_t 1 for on */
+	CMD_OP_SET_SMOOTHING,	/* uint8_t IIR shift / uint8_t shift used */
+	CMD_OP_SET_WINDOW,		/* uint32_t conversions / uint32_t conversions used */
+	CMD_OP_SET_TRIGGER,		/* CMD_TRIGGER_T */
+	CMD_OP_SET_FREQUENCY,	/* uint16_t MHz */
+	CMD_OP_SET_OUTPUT,		/* uint8_t 1 for power, 0 for samples */
+	CMD_OP_WRITE_CALIB,		/* Calibration image, see calib.h */
+	CMD_OP_READ_CALIB,		/* uint16_t offset, uint16_t length / image bytes */
+	CMD_OP_SET_PROFILE,		/* uint8_t SAMPLER_PROFILE_* / uint32_t Hz programmed */
+	CMD_OP_SET_EXT_TRIGGER,	/* CMD_EXT_TRIGGER_T */
+	CMD_OP_SET_SEQUENCE,	/* CMD_SEQUENCE_T */
+	CMD_OP_LOAD_SWEEP,		/* Sweep list, see sweep.h */
+	CMD_OP_SET_SYNC,		/* uint8_t SAMPLER_SYNC_* */
+	CMD_OP_SET_ENCODING,	/* uint8_t ENCODE_* */
+} CMD_OP_T;
+
+/**
+ * Acknowledge status codes
+ */
+typedef enum CMD_RESULT {
+	CMD_OK = 0,
+	CMD_ERR_UNKNOWN,		/* Unknown command code */
+	CMD_ERR_LENGTH,			/* Wrong payload length */
+	CMD_ERR_PARAM,			/* Parameter out of range */
+	CMD_ERR_FAILED,			/* Command was valid but could not be completed */
+} CMD_RESULT_T;
+
+/**
+ * Acknowledge, start of every STREAM_TYPE_ACK payload
+ */
+typedef struct CMD_ACK {
+	uint8_t op;				/* Command being acknowledged */
+	uint8_t result;			/* CMD_OK or CMD_ERR_* */
+} CMD_ACK_T;
+
+/**
+ * CMD_OP_SET_TRIGGER payload
+ */
+typedef struct CMD_TRIGGER {
+	uint16_t level;			/* Trigger level as a 12-bit result */
+	uint8_t falling;		/* 1 to trigger on a downward crossing */
+	uint8_t reserved;
+	uint16_t pre;			/* Samples before the trigger */
+	uint16_t post;			/* Samples from the trigger on */
+} CMD_TRIGGER_T;
+
+/**
+ * CMD_OP_SET_EXT_TRIGGER payload
+ */
+typedef struct CMD_EXT_TRIGGER {
+	uint8_t falling;		/* 1 to trigger on the falling edge */
+	uint8_t reserved;
+	uint16_t settle;		/* Delay from the edge to the first conversion in us */
+} CMD_EXT_TRIGGER_T;
+
+/**
+ * CMD_OP_SET_SEQUENCE payload
+ */
+typedef struct CMD_SEQUENCE {
+	uint32_t settle;		/* Time from the step sync output to the first conversion in us */
+	uint16_t samples;		/* Conversions per step */
+	uint16_t reserved;
+	uint32_t steps;			/* Steps to run, 0 to run until stopped */
+} CMD_SEQUENCE_T;
+
+#define CMD_STATUS_STREAMING    (1 << 0)
+#define CMD_STATUS_TADJ         (1 << 1)
+#define CMD_STATUS_POWER        (1 << 2)
+#define CMD_STATUS_CALIB        (1 << 3)	/* Calibration from EEPROM in use */
+#define CMD_STATUS_TADJ_AUTO    (1 << 4)	/* T_ADJ follows the frequency */
+
+/**
+ * CMD_OP_GET_STATUS reply
+ */
+typedef struct CMD_STATUS {
+	uint32_t rate;			/* Sample rate in Hz */
+	uint32_t max_rate;		/* Fastest sample rate in Hz */
+	uint16_t average;		/* Decimation ratio */
+	uint8_t mode;			/* MEASURE_MODE_* */
+	uint8_t flags;			/* CMD_STATUS_* */
+	uint32_t overflows;		/* Capture blocks lost */
+	uint32_t tx_dropped;	/* Bytes dropped by the VCOM driver */
+	uint32_t rx_errors;		/* Bytes discarded by the command parser */
+	uint8_t smoothing;		/* IIR smoother shift, 0 if disabled */
+	uint8_t frac_bits;		/* Fractional bits in samples */
+	uint16_t reserved;
+	uint32_t window;		/* Statistics window in conversions */
+	uint32_t tick_rate;		/* Frame tick rate in Hz */
+	uint32_t frequency;		/* Operating frequency in MHz */
+	uint32_t uid[IDENT_UID_WORDS];	/* Chip unique ID */
+	uint16_t calib_crc;		/* CRC of the active calibration image */
+	uint16_t reserved2;
+	uint32_t adc_overruns;	/* Conversions lost to ADC overrun */
+	uint32_t dma_errors;	/* DMA errors, capture restarted */
+	uint32_t block_jitter;	/* Worst capture block interval jitter in ticks, while free running */
+	uint32_t achieved_rate;	/* Sample rate measured from block timestamps */
+	uint32_t profile;		/* SAMPLER_PROFILE_* */
+	uint32_t missed_triggers;	/* External trigger edges during a measurement */
+	uint32_t steps_done;	/* Sequencer steps completed */
+	uint32_t tadj_switches;	/* T_ADJ changes */
+	uint32_t tadj_tick;		/* Frame tick of the last T_ADJ change */
+	uint32_t sync;			/* SAMPLER_SYNC_* */
+	uint32_t encoding;		/* ENCODE_* */
+} CMD_STATUS_T;
+
+/**
+ * @brief	Feed received bytes to the command parser
+ * @param	data	: Received bytes
+ * @param	len		: Number of bytes
+ * @return	Nothing
+ * @note	Every complete command is executed and acknowledged. A partial
+ * command is kept until the rest arrives. Bytes beyond command_space() are
+ * dropped.
+ */
+void command_input(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief	Get the number of bytes command_input() can take
+ * @return	Free space in the command buffer, 0 while an acknowledge is held
+ */
+uint32_t command_space(void);
+
+/**
+ * @brief	Send a held acknowledge and drop a stale partial command
+ * @return	Nothing
+ * @note	Called from the main loop before reading more input.
+ */
+void command_poll(void);
+
+/**
+ * @brief	Get the number of bytes discarded by the command parser
+ * @return	Error count since reset
+ */
+uint32_t command_errors(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMMAND_H_ */
@@ -0,0 +1,72 @@
+/*
+ * @brief Compact sample encodings
+ *
+ * @note
+ * Sample frames can be sent in a denser form than 16-bit words. Packing
+ * drops the fractional bits and stores two 12-bit samples in three bytes.
+ * Delta coding is lossless and stores the change from the previous sample
+ * as a variable length integer, which takes one byte while the signal
+ * moves by less than 4 LSB per sample.
+ */
+
+#ifndef __ENCODE_H_
+#define __ENCODE_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+/**
+ * Sample encodings
+ */
+typedef enum ENCODE_MODE {
+	ENCODE_NONE = 0,		/* 16-bit samples, STREAM_TYPE_SAMPLES */
+	ENCODE_PACK12,			/* 12-bit samples, STREAM_TYPE_PACKED */
+	ENCODE_DELTA,			/* Sample deltas, STREAM_TYPE_DELTA */
+	ENCODE_COUNT
+} ENCODE_MODE_T;
+
+/**
+ * @brief	Select the sample encoding
+ * @param	mode	: ENCODE_*
+ * @return	false if the mode is unknown
+ */
+bool encode_set_mode(uint32_t mode);
+
+/**
+ * @brief	Get the sample encoding
+ * @return	ENCODE_*
+ */
+uint32_t encode_get_mode(void);
+
+/**
+ * @brief	Encode samples
+ * @param	samples	: Samples with FILTER_FRAC_BITS fractional bits
+ * @param	n		: Number of samples
+ * @param	out		: Encoded bytes, may be the samples buffer
+ * @return	Number of bytes in out, 0 if the encoding would not be shorter
+ * than the samples and out is left unchanged
+ * @note	ENCODE_PACK12 rounds to whole 12-bit units, sample i is bits
+ * 12 * i to 12 * i + 11 of the little-endian byte string. ENCODE_DELTA
+ * stores the first sample and then the difference to the previous one,
+ * each zigzag mapped to an unsigned value and written in little-endian
+ * groups of 7 bits with bit 7 set on all but the last byte.
+ */
+uint32_t encode_samples(const uint16_t *samples, uint32_t n, uint8_t *out);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENCODE_H_ */
@@ -0,0 +1,84 @@
+/*
+ * @brief External trigger input
+ *
+ * @note
+ * An edge on the trigger pin starts a single measurement. The pin
+ * interrupt starts a one-shot settle timer and the ADC pacing timer is
+ * started when it expires, so the first conversion follows the edge by the
+ * settle delay plus at most one sample period, independent of USB latency.
+ */
+
+#ifndef __EXTRIG_H_
+#define __EXTRIG_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define EXTRIG_PORT             0		/* GPIO0 connector pin, PIO0_4 */
+#define EXTRIG_PIN              4
+#define EXTRIG_PININT           0		/* Pin interrupt channel */
+#define EXTRIG_MAX_SETTLE       65535	/* Longest settle delay in us */
+
+/**
+ * @brief	Initialize the trigger pin and the settle timer
+ * @return	Nothing
+ */
+void extrig_init(void);
+
+/**
+ * @brief	Configure the trigger
+ * @param	falling	: true to trigger on the falling edge, else rising edge
+ * @param	settle	: Delay from the edge to the first conversion in us
+ * @return	false if settle is above EXTRIG_MAX_SETTLE
+ */
+bool extrig_setup(bool falling, uint32_t settle);
+
+/**
+ * @brief	Wait for the next edge
+ * @return	Nothing
+ * @note	The sampler must be stopped, it is started by the trigger.
+ */
+void extrig_arm(void);
+
+/**
+ * @brief	Start the sequencer on the next edge
+ * @return	Nothing
+ * @note	The settle delay is not used, the sequencer step has its own.
+ */
+void extrig_arm_sequencer(void);
+
+/**
+ * @brief	Ignore the trigger input
+ * @return	Nothing
+ */
+void extrig_disarm(void);
+
+/**
+ * @brief	Get the time of the last edge
+ * @return	StopWatch tick latched in the pin interrupt
+ */
+uint32_t extrig_tick(void);
+
+/**
+ * @brief	Get the number of edges ignored during a measurement
+ * @return	Missed trigger count since reset
+ */
+uint32_t extrig_missed(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EXTRIG_H_ */
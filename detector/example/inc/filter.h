@@ -0,0 +1,85 @@
+/*
+ * @brief Sample decimation filter
+ *
+ * @note
+ * Raw ADC results are reduced to output samples by a boxcar decimator, a
+ * first order CIC, that sums a fixed number of consecutive conversions. The
+ * running sum is kept between calls, so the number of conversions per call
+ * does not have to be a multiple of the decimation ratio. An optional
+ * single pole IIR smoother runs on the decimated output.
+ *
+ * Output samples are fixed point with FILTER_FRAC_BITS fractional bits, so
+ * averaging 4^n conversions gains up to n bits over the 12-bit converter.
+ */
+
+#ifndef __FILTER_H_
+#define __FILTER_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define FILTER_MAX_AVERAGE      4096	/* Largest decimation ratio */
+#define FILTER_FRAC_BITS        4		/* Fractional bits in output samples */
+#define FILTER_MAX_SMOOTHING    8		/* Largest IIR smoother shift */
+
+/**
+ * @brief	Discard any partially accumulated output sample and IIR state
+ * @return	Nothing
+ */
+void filter_reset(void);
+
+/**
+ * @brief	Set the decimation ratio
+ * @param	n	: Conversions per output sample, clamped to 1..FILTER_MAX_AVERAGE
+ * @return	Ratio actually used
+ * @note	Resets the filter.
+ */
+uint32_t filter_set_average(uint32_t n);
+
+/**
+ * @brief	Get the decimation ratio
+ * @return	Conversions per output sample
+ */
+uint32_t filter_get_average(void);
+
+/**
+ * @brief	Set the IIR smoother time constant
+ * @param	shift	: 0 to disable, else the smoother time constant is
+ * 2^shift output samples, clamped to FILTER_MAX_SMOOTHING
+ * @return	Shift actually used
+ * @note	Resets the filter.
+ */
+uint32_t filter_set_smoothing(uint32_t shift);
+
+/**
+ * @brief	Get the IIR smoother time constant
+ * @return	Smoother shift, 0 if disabled
+ */
+uint32_t filter_get_smoothing(void);
+
+/**
+ * @brief	Reduce raw ADC results to output samples
+ * @param	raw	: Raw ADC data register words
+ * @param	len	: Number of words in raw
+ * @param	out	: Output samples, must hold len samples
+ * @return	Number of samples written to out
+ */
+uint32_t filter_process(const uint32_t *raw, uint32_t len, uint16_t *out);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FILTER_H_ */
@@ -0,0 +1,98 @@
+/*
+ * @brief Acquisition health counters
+ *
+ * @note
+ * Counts the events that make the device fall behind or lose data. The
+ * totals are reported by the status command and every event also sets a
+ * flag in the header of the next frame sent, so the host can tell which
+ * part of the stream is affected.
+ */
+
+#ifndef __HEALTH_H_
+#define __HEALTH_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+/**
+ * Frame flags, set on the first frame sent after the event
+ */
+#define HEALTH_FLAG_ADC_OVERRUN (1 << 0)	/* Conversion overwritten before the DMA read it */
+#define HEALTH_FLAG_OVERFLOW    (1 << 1)	/* Sample block not processed in time */
+#define HEALTH_FLAG_TX_DROPPED  (1 << 2)	/* VCOM driver dropped data */
+#define HEALTH_FLAG_RX_ERROR    (1 << 3)	/* Command bytes discarded */
+#define HEALTH_FLAG_DMA_ERROR   (1 << 4)	/* DMA error, capture was restarted */
+
+/**
+ * @brief	Check a captured block for ADC overruns
+ * @param	raw	: Raw SEQA_GDAT words
+ * @param	len	: Number of words
+ * @return	Nothing
+ */
+void health_check_block(const uint32_t *raw, uint32_t len);
+
+/**
+ * @brief	Count a DMA error
+ * @return	Nothing
+ * @note	Called from the DMA interrupt.
+ */
+void health_dma_error(void);
+
+/**
+ * @brief	Record how much a block interval exceeded the nominal one
+ * @param	ticks	: StopWatch ticks beyond the nominal block interval
+ * @return	Nothing
+ * @note	The interval is taken between two DMA interrupt handlers, so it
+ * shows the change in handler delay from block to block, not the delay
+ * after the DMA completion itself.
+ */
+void health_block_jitter(uint32_t ticks);
+
+/**
+ * @brief	Get the flags for the next frame
+ * @return	HEALTH_FLAG_* for the events since the last health_clear_flags()
+ */
+uint16_t health_get_flags(void);
+
+/**
+ * @brief	Clear flags that were sent
+ * @param	flags	: Flags returned by health_get_flags()
+ * @return	Nothing
+ */
+void health_clear_flags(uint16_t flags);
+
+/**
+ * @brief	Get the number of ADC overruns
+ * @return	Overrun count since reset
+ */
+uint32_t health_adc_overruns(void);
+
+/**
+ * @brief	Get the number of DMA errors
+ * @return	Error count since reset
+ */
+uint32_t health_dma_errors(void);
+
+/**
+ * @brief	Get the worst block interval jitter
+ * @return	Jitter in StopWatch ticks
+ */
+uint32_t health_block_jitter_max(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HEALTH_H_ */
@@ -0,0 +1,48 @@
+/*
+ * @brief Device identification
+ *
+ * @note
+ * The 128-bit unique ID from the IAP ROM identifies a sensor. It is
+ * reported in the status reply and as the USB serial number, so the host
+ * can tell sensors apart before opening a port.
+ */
+
+#ifndef __IDENT_H_
+#define __IDENT_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define IDENT_UID_WORDS         4
+
+/**
+ * @brief	Read the unique ID and put it in the USB serial number string
+ * @return	Nothing
+ * @note	Call before the USB stack is initialized.
+ */
+void ident_init(void);
+
+/**
+ * @brief	Get the unique ID
+ * @return	Pointer to IDENT_UID_WORDS words, first word as returned by
+ * Chip_IAP_ReadUID()
+ */
+const uint32_t *ident_get_uid(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IDENT_H_ */
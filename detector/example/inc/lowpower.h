@@ -0,0 +1,62 @@
+/*
+ * @brief Idle power management
+ *
+ * @note
+ * The main loop idles in the deepest state that keeps the device working.
+ * While the USB bus is active the PLLs have to run, so the core only
+ * sleeps. Acquisition is stopped while no host has the port open, and a
+ * suspended bus puts the chip into deep-sleep until the host resumes it.
+ */
+
+#ifndef __LOWPOWER_H_
+#define __LOWPOWER_H_
+
+#include "app_usbd_cfg.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+/**
+ * @brief	Gate the clocks of unused peripherals
+ * @return	Nothing
+ * @note	Call before the other modules are initialized, they enable the
+ * clocks they need.
+ */
+void lowpower_init(void);
+
+/**
+ * @brief	USB suspend event handler
+ * @param	hUsb	: Handle to the USB device stack
+ * @return	LPC_OK
+ */
+ErrorCode_t lowpower_usb_suspend(USBD_HANDLE_T hUsb);
+
+/**
+ * @brief	USB resume event handler
+ * @param	hUsb	: Handle to the USB device stack
+ * @return	LPC_OK
+ */
+ErrorCode_t lowpower_usb_resume(USBD_HANDLE_T hUsb);
+
+/**
+ * @brief	Wait for the next interrupt in the deepest safe state
+ * @return	Nothing
+ * @note	Called from the main loop in place of __WFI().
+ */
+void lowpower_idle(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOWPOWER_H_ */
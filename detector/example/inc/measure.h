@@ -0,0 +1,249 @@
+/*
+ * @brief Measurement control
+ *
+ * @note
+ * Ties the sample clock, DMA capture, averaging and the sample stream
+ * together. All settings that can be changed by host commands are applied
+ * through this module.
+ */
+
+#ifndef __MEASURE_H_
+#define __MEASURE_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define BOARD_TADJ_PORT         0		/* AD8319 T_ADJ resistor select */
+#define BOARD_TADJ_PIN          16
+#define MEASURE_TADJ_FREQ       5300	/* 500 ohm T_ADJ from this frequency up, in MHz */
+#define MEASURE_TADJ_SETTLE     200		/* Conversions dropped after a T_ADJ switch, in us */
+
+/**
+ * Measurement modes
+ */
+typedef enum MEASURE_MODE {
+	MEASURE_MODE_STREAM = 0,	/* Continuous sample frames */
+	MEASURE_MODE_STATS,			/* One statistics record per window */
+	MEASURE_MODE_BURST,			/* Threshold triggered bursts */
+	MEASURE_MODE_EXTERNAL,		/* One averaged sample per external trigger edge */
+	MEASURE_MODE_SEQUENCE,		/* Stream of SCT sequencer steps */
+	MEASURE_MODE_SWEEP,			/* Sweep list results */
+	MEASURE_MODE_COUNT
+} MEASURE_MODE_T;
+
+/**
+ * @brief	Initialize sampling, capture and the T_ADJ output
+ * @return	Nothing
+ * @note	Streaming starts at SAMPLER_DEFAULT_RATE with no averaging.
+ */
+void measure_init(void);
+
+/**
+ * @brief	Set the ADC sample rate
+ * @param	rate	: Requested sample rate in Hz
+ * @return	Sample rate actually programmed, in Hz
+ * @note	The capture block size follows the rate to keep latency low.
+ */
+uint32_t measure_set_rate(uint32_t rate);
+
+/**
+ * @brief	Select the ADC acquisition profile
+ * @param	profile	: SAMPLER_PROFILE_* flags
+ * @return	Sample rate in Hz
+ */
+uint32_t measure_set_profile(uint32_t profile);
+
+/**
+ * @brief	Set the number of conversions averaged per output sample
+ * @param	n	: Averaging count
+ * @return	Averaging count actually used
+ */
+uint32_t measure_set_average(uint32_t n);
+
+/**
+ * @brief	Set the IIR smoother time constant
+ * @param	shift	: 0 to disable, else 2^shift output samples
+ * @return	Shift actually used
+ */
+uint32_t measure_set_smoothing(uint32_t shift);
+
+/**
+ * @brief	Set the statistics window length
+ * @param	n	: Conversions per window
+ * @return	Window length actually used
+ */
+uint32_t measure_set_window(uint32_t n);
+
+/**
+ * @brief	Configure the burst trigger
+ * @param	level	: Trigger level as a 12-bit result
+ * @param	falling	: true to trigger on a downward crossing
+ * @param	pre		: Samples kept before the trigger
+ * @param	post	: Samples kept from the trigger on
+ * @return	false if the burst does not fit the history buffer
+ */
+bool measure_set_trigger(uint16_t level, bool falling, uint32_t pre, uint32_t post);
+
+/**
+ * @brief	Configure the external trigger
+ * @param	falling	: true to trigger on the falling edge
+ * @param	settle	: Delay from the edge to the first conversion in us
+ * @return	false if the delay is too long
+ * @note	Each edge produces one sample, the average of the number of
+ * conversions set by measure_set_average().
+ */
+bool measure_set_ext_trigger(bool falling, uint32_t settle);
+
+/**
+ * @brief	Set the sequencer timeline
+ * @param	settle	: Time from the step sync output to the first conversion in us
+ * @param	samples	: Conversions per step
+ * @param	steps	: Number of steps, 0 to run until stopped
+ * @return	false if the timeline does not fit the sample rate
+ * @note	Each step fills one capture block. Set the average to samples
+ * for one sample per step.
+ */
+bool measure_set_sequence(uint32_t settle, uint32_t samples, uint32_t steps);
+
+/**
+ * @brief	Store a sweep list
+ * @param	list	: SWEEP_LIST_HDR_T followed by SWEEP_POINT_T points
+ * @param	len		: Length of list in bytes
+ * @return	false if the list is malformed
+ * @note	In MEASURE_MODE_SWEEP the sweep restarts with the new list.
+ */
+bool measure_load_sweep(const uint8_t *list, uint32_t len);
+
+/**
+ * @brief	Select the sample clock sync role
+ * @param	role	: SAMPLER_SYNC_*
+ * @return	false if the role is unknown
+ * @note	Sample indices restart from 0. For aligned indices the slaves
+ * must be streaming before the master starts its clock, and the master must
+ * be stopped meanwhile. The sequence and sweep modes use their own clock.
+ */
+bool measure_set_sync(uint32_t role);
+
+/**
+ * @brief	Select sample or power output
+ * @param	enable	: true to send power in 0.01 dBm instead of samples
+ * @return	Nothing
+ * @note	Applies to MEASURE_MODE_STREAM, see power_set_frequency().
+ */
+void measure_set_power_output(bool enable);
+
+/**
+ * @brief	Check for power output
+ * @return	true if power is sent instead of samples
+ */
+bool measure_is_power_output(void);
+
+/**
+ * @brief	Select the T_ADJ resistor
+ * @param	high	: true for the 500 ohm (> 5.3 GHz) setting
+ * @return	Nothing
+ * @note	Turns off the automatic selection.
+ */
+void measure_set_tadj(bool high);
+
+/**
+ * @brief	Select the T_ADJ resistor from the operating frequency
+ * @return	Nothing
+ * @note	The 500 ohm setting is used from MEASURE_TADJ_FREQ up. This is
+ * the default.
+ */
+void measure_set_tadj_auto(void);
+
+/**
+ * @brief	Check for automatic T_ADJ selection
+ * @return	true if T_ADJ follows the operating frequency
+ */
+bool measure_is_tadj_auto(void);
+
+/**
+ * @brief	Get the time of the last T_ADJ switch
+ * @return	StopWatch tick of the switch
+ */
+uint32_t measure_tadj_tick(void);
+
+/**
+ * @brief	Get the number of T_ADJ switches
+ * @return	Switches since measure_init()
+ */
+uint32_t measure_tadj_switches(void);
+
+/**
+ * @brief	Set the operating frequency
+ * @param	freq	: Frequency in MHz, up to POWER_MAX_FREQ
+ * @return	Nothing
+ * @note	Selects the power calibration and, if automatic, the T_ADJ
+ * resistor. Stream and statistics results do not use conversions taken
+ * within MEASURE_TADJ_SETTLE of a switch.
+ */
+void measure_set_frequency(uint32_t freq);
+
+/**
+ * @brief	Get the T_ADJ resistor selection
+ * @return	true if the 500 ohm setting is selected
+ */
+bool measure_get_tadj(void);
+
+/**
+ * @brief	Start or stop sending results
+ * @param	enable	: true to start
+ * @return	Nothing
+ */
+void measure_set_streaming(bool enable);
+
+/**
+ * @brief	Check if results are being sent
+ * @return	true if streaming
+ */
+bool measure_is_streaming(void);
+
+/**
+ * @brief	Suspend or resume acquisition
+ * @param	suspend	: true to stop conversions and capture
+ * @return	Nothing
+ * @note	Used while no host is listening, the settings and the streaming
+ * state are kept.
+ */
+void measure_suspend(bool suspend);
+
+/**
+ * @brief	Select the measurement mode
+ * @param	mode	: MEASURE_MODE_*
+ * @return	false if the mode is not supported
+ */
+bool measure_set_mode(uint32_t mode);
+
+/**
+ * @brief	Get the measurement mode
+ * @return	MEASURE_MODE_*
+ */
+uint32_t measure_get_mode(void);
+
+/**
+ * @brief	Process captured blocks and send results
+ * @return	Nothing
+ * @note	Called from the main loop.
+ */
+void measure_poll(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEASURE_H_ */
@@ -0,0 +1,94 @@
+/*
+ * @brief Detector voltage to power conversion
+ *
+ * @note
+ * Each calibration band holds a table of power in 0.01 dBm steps at
+ * POWER_LUT_POINTS equally spaced sample values. Setting the operating
+ * frequency blends the two nearest bands into one active table, so the
+ * per-sample conversion is a table lookup and one linear interpolation
+ * using only multiply and shift.
+ */
+
+#ifndef __POWER_H_
+#define __POWER_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define POWER_LUT_SHIFT         9		/* Sample bits below the table index */
+#define POWER_LUT_POINTS        ((65536 >> POWER_LUT_SHIFT) + 1)
+#define POWER_DEFAULT_BANDS     6
+#define POWER_DEFAULT_FREQ      900		/* Frequency used after reset in MHz */
+#define POWER_MAX_FREQ          10000	/* Highest frequency in MHz */
+
+/**
+ * Calibration of one frequency band
+ */
+typedef struct POWER_BAND {
+	uint16_t freq;						/* Band frequency in MHz */
+	int16_t dbm[POWER_LUT_POINTS];		/* Power in 0.01 dBm for sample k << POWER_LUT_SHIFT */
+} POWER_BAND_T;
+
+/**
+ * Built in calibration, generated by cal_lut.py
+ */
+extern const POWER_BAND_T power_default_bands[POWER_DEFAULT_BANDS];
+
+/**
+ * @brief	Select the calibration bands
+ * @param	bands	: Bands sorted by frequency
+ * @param	num		: Number of bands, at least 1
+ * @return	Nothing
+ * @note	The bands must stay valid while in use. The active table is
+ * rebuilt for the current frequency.
+ */
+void power_set_bands(const POWER_BAND_T *bands, uint32_t num);
+
+/**
+ * @brief	Set a power offset added to every band
+ * @param	offset	: Offset in 0.01 dB
+ * @return	Nothing
+ */
+void power_set_offset(int32_t offset);
+
+/**
+ * @brief	Set the operating frequency
+ * @param	freq	: Frequency in MHz, clamped to POWER_MAX_FREQ
+ * @return	Nothing
+ * @note	Frequencies between bands are interpolated, outside them
+ * extrapolated from the two nearest bands.
+ */
+void power_set_frequency(uint32_t freq);
+
+/**
+ * @brief	Get the operating frequency
+ * @return	Frequency in MHz
+ */
+uint32_t power_get_frequency(void);
+
+/**
+ * @brief	Convert samples to power
+ * @param	in	: Samples with FILTER_FRAC_BITS fractional bits
+ * @param	out	: Power in 0.01 dBm, may be the same buffer as in
+ * @param	len	: Number of samples
+ * @return	Nothing
+ */
+void power_convert(const uint16_t *in, int16_t *out, uint32_t len);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POWER_H_ */
@@ -0,0 +1,182 @@
+/*
+ * @brief Hardware timed ADC sample clock
+ *
+ * @note
+ * The ADC sequencer A is started by the CT32B0 MAT0 output, so samples are
+ * taken at a fixed rate without any CPU involvement per conversion. The rate
+ * can be changed at runtime. A high-speed profile raises the ADC clock and
+ * can run the sequencer in burst mode for back-to-back conversions.
+ * Several detectors can share one sample clock: the master drives MAT0 on
+ * the sync output pin and the slaves trigger their ADC from the sync input.
+ */
+
+#ifndef __SAMPLER_H_
+#define __SAMPLER_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define BOARD_ADC_CH            1		/* AD8319 output, PIO0_23 */
+
+#define SAMPLER_ADC_CLOCK       1000000	/* ADC clock in Hz */
+#define SAMPLER_FAST_ADC_CLOCK  ADC_MAX_SAMPLE_RATE	/* Limited to the system clock */
+#define SAMPLER_CONV_CLOCKS     25		/* ADC clocks per 12-bit conversion */
+#define SAMPLER_MIN_RATE        1		/* Slowest sample rate in Hz */
+#define SAMPLER_DEFAULT_RATE    50		/* Sample rate used after reset */
+
+/**
+ * Acquisition profile flags
+ */
+#define SAMPLER_PROFILE_FAST    (1 << 0)	/* ADC clock at SAMPLER_FAST_ADC_CLOCK */
+#define SAMPLER_PROFILE_10BIT   (1 << 1)	/* 10-bit conversions, results keep the 12-bit scale */
+#define SAMPLER_PROFILE_BURST   (1 << 2)	/* Back-to-back conversions, implies SAMPLER_PROFILE_FAST */
+#define SAMPLER_PROFILE_MASK    0x7
+
+/**
+ * Sample clock sync pins, wired master output to slave inputs
+ */
+#define SAMPLER_SYNC_OUT_PORT   0		/* CT32B0_MAT0 on PIO0_18, U0_RXD is unused */
+#define SAMPLER_SYNC_OUT_PIN    18
+#define SAMPLER_SYNC_OUT_FUNC   IOCON_FUNC2
+#define SAMPLER_SYNC_IN_PORT    0		/* CT16B0_CAP0 on PIO0_2 */
+#define SAMPLER_SYNC_IN_PIN     2
+#define SAMPLER_SYNC_IN_FUNC    IOCON_FUNC2
+
+/**
+ * Sample clock sync role
+ */
+typedef enum SAMPLER_SYNC {
+	SAMPLER_SYNC_NONE = 0,		/* Own sample clock, sync pins unused */
+	SAMPLER_SYNC_MASTER,		/* Own sample clock, driven on the sync output */
+	SAMPLER_SYNC_SLAVE,			/* Converts on rising edges of the sync input */
+	SAMPLER_SYNC_COUNT
+} SAMPLER_SYNC_T;
+
+/**
+ * @brief	Initialize the ADC and its sample clock timer
+ * @return	Nothing
+ * @note	The ADC is calibrated and sequencer A is set up for channel
+ * BOARD_ADC_CH, triggered by CT32B0 MAT0. Sampling starts at
+ * SAMPLER_DEFAULT_RATE.
+ */
+void sampler_init(void);
+
+/**
+ * @brief	Set the ADC sample rate
+ * @param	rate	: Requested sample rate in Hz
+ * @return	Sample rate actually programmed, in Hz
+ * @note	The rate is clamped to SAMPLER_MIN_RATE..sampler_max_rate().
+ */
+uint32_t sampler_set_rate(uint32_t rate);
+
+/**
+ * @brief	Select the acquisition profile
+ * @param	profile	: Or'ed SAMPLER_PROFILE_* flags, 0 for the default 1 MHz clock
+ * @return	Sample rate in Hz
+ * @note	Without SAMPLER_PROFILE_BURST the rate stays as set, clamped to the
+ * new sampler_max_rate(). In burst mode the timer is stopped and the rate is
+ * sampler_max_rate(). SAMPLER_PROFILE_BURST is ignored in SAMPLER_SYNC_SLAVE.
+ */
+uint32_t sampler_set_profile(uint32_t profile);
+
+/**
+ * @brief	Get the acquisition profile
+ * @return	SAMPLER_PROFILE_* flags in use
+ */
+uint32_t sampler_get_profile(void);
+
+/**
+ * @brief	Start or stop conversions
+ * @param	enable	: false to stop the pacing timer or burst sequence
+ * @return	Nothing
+ * @note	The rate and profile are kept, the ADC stays calibrated. When
+ * stopping, returns after the conversion in progress has completed. A slave
+ * has no timer to run and converts whenever the master clock runs.
+ */
+void sampler_run(bool enable);
+
+/**
+ * @brief	Select the conversion trigger
+ * @param	enable	: true to convert on SCT0 OUT0, false for the pacing timer
+ * @return	Nothing
+ * @note	Conversions must be stopped with sampler_run(). The SCT trigger
+ * is used by the sequencer and does not work with SAMPLER_PROFILE_BURST.
+ * It takes precedence over the sync input of a slave.
+ */
+void sampler_set_sct_trigger(bool enable);
+
+/**
+ * @brief	Select the sample clock sync role
+ * @param	role	: SAMPLER_SYNC_*
+ * @return	false if the role is unknown
+ * @note	Conversions must be stopped with sampler_run(). A slave keeps its
+ * rate setting, which must match the master for the block timing, and drops
+ * SAMPLER_PROFILE_BURST.
+ */
+bool sampler_set_sync(uint32_t role);
+
+/**
+ * @brief	Get the sample clock sync role
+ * @return	SAMPLER_SYNC_*
+ */
+uint32_t sampler_get_sync(void);
+
+/**
+ * @brief	Get the current ADC sample rate
+ * @return	Sample rate in Hz
+ */
+uint32_t sampler_get_rate(void);
+
+/**
+ * @brief	Get the sample period in StopWatch ticks
+ * @return	Ticks between two conversions
+ */
+uint32_t sampler_period_ticks(void);
+
+/**
+ * @brief	Get the fastest sample rate the converter supports
+ * @return	Sample rate in Hz
+ * @note	Based on the 12-bit conversion time, 10-bit conversions are not
+ * slower. capture_measured_rate() gives the rate actually achieved.
+ */
+uint32_t sampler_max_rate(void);
+
+/**
+ * @brief	Arm the threshold crossing interrupt
+ * @param	level	: Threshold as a 12-bit result
+ * @return	Nothing
+ * @note	Every result carries the crossing direction in its THCMPCROSS
+ * field. The interrupt only latches the first crossing, see
+ * sampler_threshold_crossed().
+ */
+void sampler_arm_threshold(uint16_t level);
+
+/**
+ * @brief	Disable the threshold crossing interrupt
+ * @return	Nothing
+ */
+void sampler_disarm_threshold(void);
+
+/**
+ * @brief	Check for a threshold crossing since the last arm
+ * @return	true if the threshold was crossed in either direction
+ */
+bool sampler_threshold_crossed(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLER_H_ */
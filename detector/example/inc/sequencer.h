@@ -0,0 +1,83 @@
+/*
+ * @brief SCT measurement sequencer
+ *
+ * @note
+ * SCT0 runs a timeline of steps without CPU involvement. Each step asserts
+ * the sync output, waits the settle time and then triggers the ADC through
+ * SCT0 OUT0 for a fixed number of conversions at the sampler rate before the
+ * next step starts. The CPU only counts the completed steps.
+ */
+
+#ifndef __SEQUENCER_H_
+#define __SEQUENCER_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define SEQUENCER_SYNC_OUT      3		/* SCT0_OUT3, high while settling */
+#define SEQUENCER_SYNC_PORT     1		/* Test point P6, PIO1_13 */
+#define SEQUENCER_SYNC_PIN      13
+#define SEQUENCER_SYNC_FUNC     IOCON_FUNC2
+#define SEQUENCER_MAX_SETTLE    300000	/* Longest settle time in us */
+#define SEQUENCER_DEFAULT_SETTLE 1000	/* Settle time used after reset in us */
+
+/**
+ * @brief	Initialize the SCT and the sync output
+ * @return	Nothing
+ */
+void sequencer_init(void);
+
+/**
+ * @brief	Set the step timeline
+ * @param	settle	: Time from the sync output to the first conversion in us
+ * @param	samples	: Conversions per step, 1 to CAPTURE_BLOCK_MAX
+ * @param	steps	: Number of steps to run, 0 to run until stopped
+ * @return	false if a parameter is out of range or the timing does not fit
+ * the sample rate
+ * @note	The dwell window is samples sample periods at the sampler rate.
+ */
+bool sequencer_setup(uint32_t settle, uint32_t samples, uint32_t steps);
+
+/**
+ * @brief	Start the timeline from the first step
+ * @return	false if the timing does not fit the current sample rate
+ * @note	The sampler must pace conversions from the SCT, see
+ * sampler_set_sct_trigger(). Can be called from an interrupt handler.
+ */
+bool sequencer_start(void);
+
+/**
+ * @brief	Stop the timeline
+ * @return	Nothing
+ */
+void sequencer_stop(void);
+
+/**
+ * @brief	Get the number of conversions per step
+ * @return	Conversions in each dwell window
+ */
+uint32_t sequencer_samples(void);
+
+/**
+ * @brief	Get the number of completed steps
+ * @return	Steps completed since sequencer_start()
+ */
+uint32_t sequencer_steps_done(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SEQUENCER_H_ */
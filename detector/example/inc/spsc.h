@@ -0,0 +1,138 @@
+/*
+ * @brief Single-producer/single-consumer ring
+ *
+ * @note
+ * One context only adds items and one context only removes them, e.g. the
+ * main loop and an interrupt handler, so no critical sections are needed.
+ * The size is a power of 2 and the head and tail counters run freely, an
+ * index is a counter masked by size - 1. Items are handed out as
+ * contiguous spans of the storage, so a producer or consumer can fill or
+ * read them in place. There are no single item helpers, the only ring
+ * holds TX packets and a span of one item is just as cheap.
+ */
+
+#ifndef __SPSC_H_
+#define __SPSC_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+/**
+ * Ring state, head is only written by the producer and tail by the consumer
+ */
+typedef struct SPSC_RING {
+	uint8_t *data;
+	uint32_t itemSize;
+	uint32_t mask;			/* Number of items - 1 */
+	volatile uint32_t head;	/* Items added */
+	volatile uint32_t tail;	/* Items removed */
+} SPSC_RING_T;
+
+/**
+ * @brief	Initialize a ring
+ * @param	ring		: Ring to initialize
+ * @param	buffer		: Storage for count items, aligned for the item type
+ * @param	itemSize	: Size of an item in bytes
+ * @param	count		: Number of items, a power of 2
+ * @return	false if count is not a power of 2
+ */
+bool spsc_init(SPSC_RING_T *ring, void *buffer, uint32_t itemSize, uint32_t count);
+
+/**
+ * @brief	Discard all items, consumer side
+ * @param	ring	: Ring to empty
+ * @return	Nothing
+ */
+void spsc_flush(SPSC_RING_T *ring);
+
+/**
+ * @brief	Get the number of items in a ring
+ * @param	ring	: Ring to check
+ * @return	Items the consumer can take
+ */
+static INLINE uint32_t spsc_count(const SPSC_RING_T *ring) {
+	return ring->head - ring->tail;
+}
+
+/**
+ * @brief	Get the free space in a ring
+ * @param	ring	: Ring to check
+ * @return	Items the producer can add
+ */
+static INLINE uint32_t spsc_free(const SPSC_RING_T *ring) {
+	return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+/**
+ * @brief	Get the free items following the head, producer side
+ * @param	ring	: Ring to fill
+ * @param	len		: Returns the number of contiguous free items
+ * @return	Pointer to the first free item
+ * @note	The items become visible to the consumer with spsc_commit().
+ */
+static INLINE void *spsc_write_span(SPSC_RING_T *ring, uint32_t *len) {
+	uint32_t idx = ring->head & ring->mask;
+	uint32_t n = ring->mask + 1 - idx;
+	uint32_t space = spsc_free(ring);
+
+	*len = n < space ? n : space;
+	return &ring->data[idx * ring->itemSize];
+}
+
+/**
+ * @brief	Add items filled in through spsc_write_span(), producer side
+ * @param	ring	: Ring to fill
+ * @param	n		: Number of items, up to the span length
+ * @return	Nothing
+ */
+static INLINE void spsc_commit(SPSC_RING_T *ring, uint32_t n) {
+	/* Item data must be written before the consumer sees the new head */
+	__DMB();
+	ring->head += n;
+}
+
+/**
+ * @brief	Get the items following the tail, consumer side
+ * @param	ring	: Ring to read
+ * @param	len		: Returns the number of contiguous items
+ * @return	Pointer to the oldest item
+ * @note	The items stay valid until spsc_release().
+ */
+static INLINE void *spsc_read_span(SPSC_RING_T *ring, uint32_t *len) {
+	uint32_t idx = ring->tail & ring->mask;
+	uint32_t n = ring->mask + 1 - idx;
+	uint32_t count = spsc_count(ring);
+
+	*len = n < count ? n : count;
+	return &ring->data[idx * ring->itemSize];
+}
+
+/**
+ * @brief	Remove items read through spsc_read_span(), consumer side
+ * @param	ring	: Ring to read
+ * @param	n		: Number of items, up to the span length
+ * @return	Nothing
+ */
+static INLINE void spsc_release(SPSC_RING_T *ring, uint32_t n) {
+	/* Item data must be read before the producer may overwrite it */
+	__DMB();
+	ring->tail += n;
+}
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SPSC_H_ */
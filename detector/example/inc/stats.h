@@ -0,0 +1,80 @@
+/*
+ * @brief Per-window sample statistics
+ *
+ * @note
+ * Raw ADC results are accumulated over a window of conversions and reduced
+ * to one STATS_RECORD_T holding minimum, maximum, mean and RMS. Windows
+ * continue across calls, so they do not have to line up with capture
+ * blocks.
+ */
+
+#ifndef __STATS_H_
+#define __STATS_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define STATS_MIN_WINDOW        16			/* Fewest conversions per window */
+#define STATS_MAX_WINDOW        1000000		/* Most conversions per window */
+#define STATS_DEFAULT_WINDOW    1000
+
+/**
+ * Statistics of one window, mean and RMS have FILTER_FRAC_BITS fractional
+ * bits, minimum and maximum are plain 12-bit results
+ */
+typedef struct STATS_RECORD {
+	uint32_t count;			/* Conversions in the window */
+	uint16_t min;
+	uint16_t max;
+	uint16_t mean;
+	uint16_t rms;
+} STATS_RECORD_T;
+
+/**
+ * @brief	Discard the partially accumulated window
+ * @return	Nothing
+ */
+void stats_reset(void);
+
+/**
+ * @brief	Set the window length
+ * @param	n	: Conversions per window, clamped to STATS_MIN_WINDOW..STATS_MAX_WINDOW
+ * @return	Window length actually used
+ * @note	Resets the statistics.
+ */
+uint32_t stats_set_window(uint32_t n);
+
+/**
+ * @brief	Get the window length
+ * @return	Conversions per window
+ */
+uint32_t stats_get_window(void);
+
+/**
+ * @brief	Accumulate raw ADC results
+ * @param	raw		: Raw ADC data register words
+ * @param	len		: Number of words in raw
+ * @param	rec		: Records for completed windows
+ * @param	maxRec	: Number of records rec can hold, must be at least
+ * len / STATS_MIN_WINDOW + 1
+ * @return	Number of windows completed
+ */
+uint32_t stats_process(const uint32_t *raw, uint32_t len, STATS_RECORD_T *rec, uint32_t maxRec);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STATS_H_ */
@@ -0,0 +1,103 @@
+/*
+ * @brief Sample stream framing
+ *
+ * @note
+ * Everything sent to the host is wrapped in a versioned frame: a fixed
+ * header with sync word, frame type, sequence number, item count, device
+ * tick and CRC, followed by a type specific payload. A frame may span
+ * several bulk packets.
+ */
+
+#ifndef __STREAM_H_
+#define __STREAM_H_
+
+#include "app_usbd_cfg.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define STREAM_SYNC             0x5AA5	/* Sent as 0xA5 0x5A */
+#define STREAM_VERSION          4
+#define STREAM_MAX_PAYLOAD      256		/* Largest payload in bytes */
+
+/**
+ * Frame types
+ */
+typedef enum STREAM_TYPE {
+	STREAM_TYPE_SAMPLES = 1,	/* 16-bit samples, FILTER_FRAC_BITS fractional bits */
+	STREAM_TYPE_ACK,			/* Command acknowledge, see command.h */
+	STREAM_TYPE_STATS,			/* STATS_RECORD_T per completed window */
+	STREAM_TYPE_BURST,			/* BURST_FRAME_T, count is samples */
+	STREAM_TYPE_POWER,			/* int16_t power in 0.01 dBm */
+	STREAM_TYPE_SWEEP,			/* SWEEP_FRAME_T, count is points */
+	STREAM_TYPE_SOF,			/* uint16_t USB frame number, see usbsync.h */
+	STREAM_TYPE_PACKED,			/* 12-bit samples, see encode.h, count is samples */
+	STREAM_TYPE_DELTA,			/* Delta coded samples, see encode.h, count is samples */
+} STREAM_TYPE_T;
+
+/**
+ * Frame header, all fields little-endian
+ * The tick runs at StopWatch_TicksPerSecond(). Sample and statistics frames
+ * carry the tick of the block completion after their last conversion, burst
+ * frames the tick of the trigger sample, sweep frames the tick after the
+ * last conversion of the sweep, SOF frames the tick latched at the SOF and
+ * acknowledges the time they were sent. The flags report health events
+ * since the previous frame, see health.h. Sample, power and statistics
+ * frames carry the sample index of their block, see capture_block_index(),
+ * other frames 0.
+ */
+typedef struct STREAM_HDR {
+	uint16_t sync;			/* STREAM_SYNC */
+	uint8_t version;		/* STREAM_VERSION */
+	uint8_t type;			/* STREAM_TYPE_* */
+	uint16_t seq;			/* Incremented for every frame sent */
+	uint16_t len;			/* Payload length in bytes */
+	uint32_t tick;			/* StopWatch tick the payload refers to */
+	uint16_t count;			/* Number of items in the payload */
+	uint16_t flags;			/* HEALTH_FLAG_* */
+	uint16_t index;			/* Sample index, low 16 bits */
+	uint16_t crc;			/* CRC-16/ARC of header (crc = 0) and payload */
+} STREAM_HDR_T;
+
+/**
+ * @brief	Initialize frame sequencing and the CRC engine
+ * @return	Nothing
+ */
+void stream_init(void);
+
+/**
+ * @brief	Send a frame
+ * @param	type	: Frame type, STREAM_TYPE_*
+ * @param	count	: Number of items in the payload
+ * @param	tick	: Device tick the payload refers to
+ * @param	index	: Sample index the payload refers to, 0 if none
+ * @param	payload	: Payload data, may be NULL if len is 0
+ * @param	len		: Payload length in bytes, up to STREAM_MAX_PAYLOAD
+ * @return	true if the frame was queued, false if the TX queue is too full
+ */
+bool stream_send(uint8_t type, uint16_t count, uint32_t tick, uint32_t index,
+				 const void *payload, uint32_t len);
+
+/**
+ * @brief	Compute the CRC used by frames and commands
+ * @param	data	: Data to check
+ * @param	len		: Number of bytes
+ * @return	CRC-16/ARC of data
+ */
+uint16_t stream_crc16(const void *data, uint32_t len);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STREAM_H_ */
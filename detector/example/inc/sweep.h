@@ -0,0 +1,140 @@
+/*
+ * @brief On-device sweep list
+ *
+ * @note
+ * A list of sweep points is uploaded once. Every point is measured by one
+ * sequencer step, started by the sequencer right after the previous point
+ * or by the external trigger. The averaged result of each point is kept
+ * until the whole sweep is done and then read out in pieces.
+ */
+
+#ifndef __SWEEP_H_
+#define __SWEEP_H_
+
+#include "board.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define SWEEP_MAX_POINTS        128
+#define SWEEP_FRAME_POINTS      120		/* Results per SWEEP_FRAME_T */
+
+/**
+ * Sweep list flags
+ */
+#define SWEEP_FLAG_EXTERNAL     (1 << 0)	/* Wait for an external trigger edge before each point */
+#define SWEEP_FLAG_REPEAT       (1 << 1)	/* Start over once the results are read */
+#define SWEEP_FLAG_POWER        (1 << 15)	/* Results are power, set in SWEEP_HDR_T only */
+
+/**
+ * Result of a point whose timing does not fit the sample rate
+ */
+#define SWEEP_INVALID_SAMPLE    0xFFFF	/* Above any averaged 12-bit result */
+#define SWEEP_INVALID_POWER     (-32768)
+
+/**
+ * Sweep list header, followed by the points
+ */
+typedef struct SWEEP_LIST_HDR {
+	uint16_t flags;			/* SWEEP_FLAG_* */
+	uint16_t reserved;
+} SWEEP_LIST_HDR_T;
+
+/**
+ * Sweep point
+ */
+typedef struct SWEEP_POINT {
+	uint16_t settle;		/* Time from the step to the first conversion in us */
+	uint16_t samples;		/* Conversions averaged, 1 to CAPTURE_BLOCK_MAX */
+	uint16_t freq;			/* Frequency for the calibration in MHz */
+	uint8_t tadj;			/* 1 for the 500 ohm T_ADJ resistor, unused if automatic */
+	uint8_t reserved;
+} SWEEP_POINT_T;
+
+/**
+ * Result piece header
+ */
+typedef struct SWEEP_HDR {
+	uint16_t offset;		/* Index of the first point of this piece */
+	uint16_t total;			/* Points in the whole sweep */
+	uint16_t flags;			/* SWEEP_FLAG_* */
+} SWEEP_HDR_T;
+
+/**
+ * Result piece, samples or power as in the sample stream
+ */
+typedef struct SWEEP_FRAME {
+	SWEEP_HDR_T hdr;
+	uint16_t results[SWEEP_FRAME_POINTS];
+} SWEEP_FRAME_T;
+
+/**
+ * @brief	Store a sweep list
+ * @param	list	: SWEEP_LIST_HDR_T followed by the points
+ * @param	len		: Length of list in bytes
+ * @return	false if the list is malformed or a point is out of range
+ * @note	Any sweep in progress is discarded.
+ */
+bool sweep_load(const uint8_t *list, uint32_t len);
+
+/**
+ * @brief	Get the flags of the sweep list
+ * @return	SWEEP_FLAG_* of the list
+ */
+uint32_t sweep_get_flags(void);
+
+/**
+ * @brief	Start the sweep from the first point
+ * @return	Nothing
+ */
+void sweep_start(void);
+
+/**
+ * @brief	Stop the sweep and discard its results
+ * @return	Nothing
+ */
+void sweep_stop(void);
+
+/**
+ * @brief	Get the point to measure next
+ * @return	Pointer to the point, or NULL if no sweep is running
+ */
+const SWEEP_POINT_T *sweep_point(void);
+
+/**
+ * @brief	Store the result of the point from sweep_point()
+ * @param	raw		: Raw ADC data register words of the point, NULL if
+ * the point could not be measured
+ * @param	len		: Number of words in raw
+ * @param	tick	: StopWatch tick of the last word in raw
+ * @param	power	: true to store power at the current calibration frequency
+ * @return	Nothing
+ * @note	Advances to the next point, the results are ready after the last one.
+ */
+void sweep_process(const uint32_t *raw, uint32_t len, uint32_t tick, bool power);
+
+/**
+ * @brief	Read the next piece of a completed sweep
+ * @param	frm		: Piece to fill in
+ * @param	tick	: StopWatch tick of the last conversion of the sweep
+ * @return	Number of results in the piece, 0 if no sweep is ready
+ * @note	After the last piece the sweep starts over with SWEEP_FLAG_REPEAT
+ * and stops otherwise.
+ */
+uint32_t sweep_read(SWEEP_FRAME_T *frm, uint32_t *tick);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SWEEP_H_ */
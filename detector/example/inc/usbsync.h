@@ -0,0 +1,70 @@
+/*
+ * @brief USB start-of-frame time reference
+ *
+ * @note
+ * The host controller sends a start-of-frame packet with an 11-bit frame
+ * number every millisecond to all devices on its bus. The device tick is
+ * latched at each SOF and a frame number with its tick is sent with the
+ * sample stream, so the host can put the streams of several detectors on
+ * the common USB frame clock.
+ */
+
+#ifndef __USBSYNC_H_
+#define __USBSYNC_H_
+
+#include "app_usbd_cfg.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @ingroup EXAMPLES_USBDROM_11U6X_CDC
+ * @{
+ */
+
+#define USBSYNC_INTERVAL        100			/* SOFs between two sent frame numbers */
+#define USBSYNC_FRAME_INT       (1UL << 30)	/* INTSTAT frame interrupt */
+#define USBSYNC_FRAME_NR_MASK   0x7FF		/* INFO frame number */
+
+/**
+ * @brief	Set the USB stack used for the SOF interrupt
+ * @param	hUsb	: Handle to the USB device stack
+ * @return	Nothing
+ * @note	Applies the last usbsync_enable() setting.
+ */
+void usbsync_init(USBD_HANDLE_T hUsb);
+
+/**
+ * @brief	Enable or disable the SOF interrupt
+ * @param	enable	: true while the sample stream runs
+ * @return	Nothing
+ * @note	The SOF interrupt fires every millisecond, it is off while idle.
+ */
+void usbsync_enable(bool enable);
+
+/**
+ * @brief	Latch the device tick and frame number of a SOF
+ * @return	Nothing
+ * @note	Called from the USB interrupt handler before the ROM driver
+ * clears the frame interrupt.
+ */
+void usbsync_sof(void);
+
+/**
+ * @brief	Send the latest frame number and its tick
+ * @return	Nothing
+ * @note	Called from the main loop, sends one STREAM_TYPE_SOF frame every
+ * USBSYNC_INTERVAL SOFs.
+ */
+void usbsync_poll(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBSYNC_H_ */
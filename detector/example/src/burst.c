@@ -0,0 +1,153 @@
+/*
+ * @brief Triggered burst capture
+ *
+ * @note
+ * The ADC compares every result against threshold 0 and stores the
+ * crossing direction in the result word. The threshold interrupt only
+ * tells that a crossing happened, the exact trigger sample is found from
+ * the THCMPCROSS field, so the trigger is sample accurate without an
+ * interrupt per conversion. Blocks are not scanned until the interrupt
+ * has fired.
+ */
+#include "board.h"
+#include "sampler.h"
+#include "burst.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define BURST_MASK              (BURST_MAX_SAMPLES - 1)
+
+typedef enum BURST_STATE {
+	BURST_IDLE,
+	BURST_ARMED,			/* Filling history, waiting for trigger */
+	BURST_POST,				/* Collecting post-trigger samples */
+	BURST_READY,			/* Burst frozen, being read out */
+} BURST_STATE_T;
+
+static uint16_t history[BURST_MAX_SAMPLES];
+static uint32_t histWr;
+static uint32_t histFilled;
+
+static BURST_STATE_T state;
+static uint16_t trigLevel = BURST_DEFAULT_LEVEL;
+static uint32_t trigCross = ADC_DR_THCMPCROSS_UPWARD;
+static uint32_t preLen = BURST_DEFAULT_PRE;
+static uint32_t postLen = BURST_DEFAULT_POST;
+
+/* Frozen burst */
+static uint32_t burstStart;
+static uint32_t burstPre;
+static uint32_t burstTotal;
+static uint32_t burstTick;
+static uint32_t postLeft;
+static uint32_t readOffset;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Configure the trigger and burst length */
+bool burst_setup(uint16_t level, bool falling, uint32_t pre, uint32_t post)
+{
+	if (post == 0 || pre + post > BURST_MAX_SAMPLES) {
+		return false;
+	}
+	trigLevel = level;
+	trigCross = falling ? ADC_DR_THCMPCROSS_DOWNWARD : ADC_DR_THCMPCROSS_UPWARD;
+	preLen = pre;
+	postLen = post;
+
+	return true;
+}
+
+/* Discard any burst and wait for a new trigger */
+void burst_arm(void)
+{
+	histWr = 0;
+	histFilled = 0;
+	state = BURST_ARMED;
+	sampler_arm_threshold(trigLevel);
+}
+
+/* Stop waiting for a trigger */
+void burst_disarm(void)
+{
+	sampler_disarm_threshold();
+	state = BURST_IDLE;
+}
+
+/* Feed raw ADC results to the burst capture */
+void burst_process(const uint32_t *raw, uint32_t len, uint32_t tick)
+{
+	uint32_t i;
+	bool scan;
+
+	if (state != BURST_ARMED && state != BURST_POST) {
+		return;
+	}
+
+	/* The crossing is in this block or a later one once the interrupt fired */
+	scan = sampler_threshold_crossed();
+
+	for (i = 0; i < len; i++) {
+		if (scan && state == BURST_ARMED &&
+			ADC_DR_THCMPCROSS(raw[i]) == trigCross) {
+			burstPre = (histFilled < preLen) ? histFilled : preLen;
+			burstStart = (histWr - burstPre) & BURST_MASK;
+			burstTotal = burstPre + postLen;
+			postLeft = postLen;
+			burstTick = tick - (len - 1 - i) * sampler_period_ticks();
+			state = BURST_POST;
+		}
+
+		history[histWr] = ADC_DR_RESULT(raw[i]);
+		histWr = (histWr + 1) & BURST_MASK;
+		if (histFilled < BURST_MAX_SAMPLES) {
+			histFilled++;
+		}
+
+		if (state == BURST_POST && --postLeft == 0) {
+			readOffset = 0;
+			state = BURST_READY;
+			return;
+		}
+	}
+}
+
+/* Read the next piece of a completed burst */
+uint32_t burst_read(BURST_FRAME_T *frm, uint32_t *tick)
+{
+	uint32_t i, cnt;
+
+	if (state != BURST_READY) {
+		return 0;
+	}
+
+	cnt = burstTotal - readOffset;
+	if (cnt > BURST_FRAME_SAMPLES) {
+		cnt = BURST_FRAME_SAMPLES;
+	}
+	frm->hdr.offset = readOffset;
+	frm->hdr.total = burstTotal;
+	frm->hdr.pre = burstPre;
+	*tick = burstTick;
+	for (i = 0; i < cnt; i++) {
+		frm->samples[i] = history[(burstStart + readOffset + i) & BURST_MASK];
+	}
+
+	readOffset += cnt;
+	if (readOffset == burstTotal) {
+		burst_arm();
+	}
+	return cnt;
+}
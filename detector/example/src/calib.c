@@ -0,0 +1,202 @@
+/*
+ * @brief Calibration storage in EEPROM
+ *
+ * @note
+ * The RAM cache always holds a valid image. When the EEPROM is blank or
+ * corrupt the cache holds a header for the built in bands, so a read back
+ * always describes what is in use.
+ */
+#include <stddef.h>
+#include <string.h>
+#include "board.h"
+#include "iap.h"
+#include "eeprom.h"
+#include "stream.h"
+#include "calib.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define CALIB_VERIFY_CHUNK      64
+
+static struct {
+	CALIB_HDR_T hdr;
+	POWER_BAND_T bands[CALIB_MAX_BANDS];
+} calib;
+
+static bool calibStored;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Size of an image with the given number of bands */
+static uint32_t calib_size(uint32_t bands)
+{
+	return sizeof(CALIB_HDR_T) + bands * sizeof(POWER_BAND_T);
+}
+
+/* Check an image header and length, returns false if not usable */
+static bool calib_check_hdr(const CALIB_HDR_T *hdr, uint32_t len)
+{
+	return hdr->magic == CALIB_MAGIC && hdr->version == CALIB_VERSION &&
+		   hdr->points == POWER_LUT_POINTS && hdr->bands <= CALIB_MAX_BANDS &&
+		   len == calib_size(hdr->bands);
+}
+
+/* Check the CRC of a complete image */
+static bool calib_check_crc(const uint8_t *image, uint32_t len)
+{
+	const CALIB_HDR_T *hdr = (const CALIB_HDR_T *) image;
+
+	return stream_crc16(image + sizeof(hdr->crc), len - sizeof(hdr->crc)) == hdr->crc;
+}
+
+/* Check that band frequencies in an image are in range and strictly
+   ascending, the power interpolation divides by the gap between bands */
+static bool calib_check_bands(const uint8_t *image, uint32_t bands)
+{
+	const uint8_t *band = image + sizeof(CALIB_HDR_T);
+	uint16_t freq, prev = 0;
+	uint32_t i;
+
+	for (i = 0; i < bands; i++, band += sizeof(POWER_BAND_T)) {
+		/* The image may not be aligned */
+		memcpy(&freq, band + offsetof(POWER_BAND_T, freq), sizeof(freq));
+		if (freq > POWER_MAX_FREQ || (i > 0 && freq <= prev)) {
+			return false;
+		}
+		prev = freq;
+	}
+	return true;
+}
+
+/* Cache a header for the built in bands */
+static void calib_set_defaults(void)
+{
+	memset(&calib.hdr, 0, sizeof(calib.hdr));
+	calib.hdr.version = CALIB_VERSION;
+	calib.hdr.magic = CALIB_MAGIC;
+	calib.hdr.points = POWER_LUT_POINTS;
+	calib.hdr.crc = stream_crc16((uint8_t *) &calib.hdr + sizeof(calib.hdr.crc),
+								 sizeof(calib.hdr) - sizeof(calib.hdr.crc));
+	calibStored = false;
+}
+
+/* Hand the cached image to the power conversion */
+static void calib_apply(void)
+{
+	power_set_offset(calib.hdr.offset);
+	if (calib.hdr.bands > 0) {
+		power_set_bands(calib.bands, calib.hdr.bands);
+	}
+	else {
+		power_set_bands(power_default_bands, POWER_DEFAULT_BANDS);
+	}
+}
+
+/* Compare the EEPROM against the cache */
+static bool calib_verify(uint32_t len)
+{
+	uint8_t buf[CALIB_VERIFY_CHUNK];
+	uint32_t pos, n;
+
+	for (pos = 0; pos < len; pos += n) {
+		n = len - pos;
+		if (n > sizeof(buf)) {
+			n = sizeof(buf);
+		}
+		if (Chip_EEPROM_Read(CALIB_EEPROM_ADDR + pos, buf, n) != IAP_CMD_SUCCESS ||
+			memcmp(buf, (uint8_t *) &calib + pos, n) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Load the calibration from EEPROM into RAM and apply it */
+void calib_init(void)
+{
+	uint32_t len;
+
+	if (Chip_EEPROM_Read(CALIB_EEPROM_ADDR, (uint8_t *) &calib.hdr,
+						 sizeof(calib.hdr)) == IAP_CMD_SUCCESS &&
+		calib.hdr.bands <= CALIB_MAX_BANDS) {
+		len = calib_size(calib.hdr.bands);
+		if (calib_check_hdr(&calib.hdr, len) &&
+			Chip_EEPROM_Read(CALIB_EEPROM_ADDR + sizeof(calib.hdr), (uint8_t *) calib.bands,
+							 len - sizeof(calib.hdr)) == IAP_CMD_SUCCESS &&
+			calib_check_crc((uint8_t *) &calib, len)) {
+			calibStored = true;
+			calib_apply();
+			return;
+		}
+	}
+
+	calib_set_defaults();
+	calib_apply();
+}
+
+/* Store and apply a new calibration image */
+CALIB_RESULT_T calib_write(const uint8_t *image, uint32_t len)
+{
+	CALIB_HDR_T hdr;
+
+	if (len < sizeof(hdr)) {
+		return CALIB_ERR_INVALID;
+	}
+	memcpy(&hdr, image, sizeof(hdr));
+	if (!calib_check_hdr(&hdr, len) || !calib_check_crc(image, len) ||
+		!calib_check_bands(image, hdr.bands)) {
+		return CALIB_ERR_INVALID;
+	}
+
+	memcpy(&calib, image, len);
+	if (Chip_EEPROM_Write(CALIB_EEPROM_ADDR, (uint8_t *) &calib, len) != IAP_CMD_SUCCESS ||
+		!calib_verify(len)) {
+		/* Fall back to whatever the EEPROM holds now */
+		calib_init();
+		return CALIB_ERR_EEPROM;
+	}
+
+	calibStored = true;
+	calib_apply();
+	return CALIB_OK;
+}
+
+/* Read back part of the active calibration image */
+uint32_t calib_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+	uint32_t size = calib_size(calib.hdr.bands);
+
+	if (offset >= size) {
+		return 0;
+	}
+	if (len > size - offset) {
+		len = size - offset;
+	}
+	memcpy(buf, (uint8_t *) &calib + offset, len);
+
+	return len;
+}
+
+/* Check if a stored calibration is in use */
+bool calib_is_stored(void)
+{
+	return calibStored;
+}
+
+/* Get the CRC of the active calibration image */
+uint16_t calib_get_crc(void)
+{
+	return calib.hdr.crc;
+}
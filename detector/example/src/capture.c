@@ -0,0 +1,270 @@
+/*
+ * @brief DMA ping-pong capture of ADC results
+ *
+ * @note
+ * The DMA channel is triggered by the sequence A interrupt signal. The
+ * sequencer runs in end-of-conversion mode, so reading SEQA_GDAT clears the
+ * request and arms the next trigger. Block 0 completion raises INTA and
+ * block 1 completion raises INTB, the two descriptors reload each other.
+ * With a block limit the descriptor of the last block does not reload, so
+ * the channel stops in hardware after the last conversion.
+ * A DMA error stops the channel, capture is restarted on the next poll.
+ */
+#include "board.h"
+#include "stopwatch.h"
+#include "sampler.h"
+#include "health.h"
+#include "capture.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Reload descriptors, must be 16 byte aligned */
+static DMA_CHDESC_T captureDesc[2] __attribute__ ((aligned(16)));
+
+static uint32_t captureBuf[2][CAPTURE_BLOCK_MAX];
+static uint32_t captureTick[2];
+static uint32_t blockLen;
+
+/* Blocks to fill before the channel stops, 0 for no limit */
+static uint32_t blockLimit;
+
+/* Conversions since capture_start(), up to the end of each block */
+static uint32_t captureIndex[2];
+static uint32_t conversions;
+
+/* Nominal ticks between block completions, for the block jitter */
+static uint32_t blockTicks;
+static bool freeRunning;
+static bool tickValid;
+static volatile uint32_t lastInterval;
+static volatile bool dmaError;
+
+/* Completed blocks, bit n set when block n is filled and not released */
+static volatile uint32_t readyMask;
+static uint32_t nextBlock;
+static volatile uint32_t overflows;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Fill in the descriptor for one sample block */
+static void capture_setup_desc(uint32_t idx)
+{
+	captureDesc[idx].xfercfg = DMA_XFERCFG_CFGVALID | DMA_XFERCFG_RELOAD |
+							   (idx ? DMA_XFERCFG_SETINTB : DMA_XFERCFG_SETINTA) |
+							   DMA_XFERCFG_WIDTH_32 | DMA_XFERCFG_SRCINC_0 |
+							   DMA_XFERCFG_DSTINC_1 | DMA_XFERCFG_XFERCOUNT(blockLen);
+	captureDesc[idx].source = DMA_ADDR(&LPC_ADC->SEQ_GDAT[ADC_SEQA_IDX]);
+	captureDesc[idx].dest = DMA_ADDR(&captureBuf[idx][blockLen - 1]);
+	captureDesc[idx].next = DMA_ADDR(&captureDesc[idx ^ 1]);
+}
+
+/* Mark a block as completed */
+static void capture_block_done(uint32_t idx)
+{
+	uint32_t tick = StopWatch_Start();
+	uint32_t elapsed = tick - captureTick[idx ^ 1];
+
+	/* Free running blocks complete at a fixed rate, a handler later than
+	   the previous one shows as a longer interval */
+	if (tickValid) {
+		lastInterval = elapsed;
+		if (freeRunning && elapsed > blockTicks) {
+			health_block_jitter(elapsed - blockTicks);
+		}
+	}
+	tickValid = true;
+
+	captureTick[idx] = tick;
+	conversions += blockLen;
+
+	/* The channel now runs the other descriptor, this one is loaded next
+	   for the block after it */
+	if (blockLimit > 0 && conversions / blockLen + 2 == blockLimit) {
+		captureDesc[idx].xfercfg &= ~DMA_XFERCFG_RELOAD;
+	}
+	captureIndex[idx] = conversions;
+	if (readyMask & (1 << idx)) {
+		overflows++;
+	}
+	readyMask |= (1 << idx);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/**
+ * @brief	Handle interrupt from DMA
+ * @return	Nothing
+ */
+void DMA_IRQHandler(void)
+{
+	if (Chip_DMA_GetActiveIntAChannels(LPC_DMA) & (1 << CAPTURE_DMA_CH)) {
+		Chip_DMA_ClearActiveIntAChannel(LPC_DMA, CAPTURE_DMA_CH);
+		capture_block_done(0);
+	}
+	if (Chip_DMA_GetActiveIntBChannels(LPC_DMA) & (1 << CAPTURE_DMA_CH)) {
+		Chip_DMA_ClearActiveIntBChannel(LPC_DMA, CAPTURE_DMA_CH);
+		capture_block_done(1);
+	}
+	if (Chip_DMA_GetErrorIntChannels(LPC_DMA) & (1 << CAPTURE_DMA_CH)) {
+		Chip_DMA_ClearErrorIntChannel(LPC_DMA, CAPTURE_DMA_CH);
+		health_dma_error();
+		dmaError = true;
+	}
+}
+
+/* Initialize the DMA controller for ADC capture */
+void capture_init(void)
+{
+	Chip_DMA_Init(LPC_DMA);
+	Chip_DMA_Enable(LPC_DMA);
+	Chip_DMA_SetSRAMBase(LPC_DMA, DMA_ADDR(Chip_DMA_Table));
+
+	/* One transfer per rising edge of the ADC sequence A interrupt */
+	Chip_DMA_SetHWTrigger(LPC_DMATRIGMUX, CAPTURE_DMA_CH, DMATRIG_ADC0_SEQA_IRQ);
+	Chip_DMA_SetupChannelConfig(LPC_DMA, CAPTURE_DMA_CH,
+								(DMA_CFG_HWTRIGEN | DMA_CFG_TRIGPOL_HIGH |
+								 DMA_CFG_TRIGTYPE_EDGE | DMA_CFG_TRIGBURST_SNGL |
+								 DMA_CFG_CHPRIORITY(0)));
+	Chip_DMA_EnableIntChannel(LPC_DMA, CAPTURE_DMA_CH);
+
+	NVIC_EnableIRQ(DMA_IRQn);
+}
+
+/* Start filling sample blocks */
+void capture_start(uint32_t len)
+{
+	capture_start_blocks(len, 0);
+}
+
+/* Start filling a limited number of sample blocks */
+void capture_start_blocks(uint32_t len, uint32_t blocks)
+{
+	uint32_t tps = StopWatch_TicksPerSecond();
+	uint32_t rate = sampler_get_rate();
+
+	capture_stop();
+
+	if (len == 0) {
+		len = 1;
+	}
+	else if (len > CAPTURE_BLOCK_MAX) {
+		len = CAPTURE_BLOCK_MAX;
+	}
+	blockLen = len;
+	blockTicks = len * (tps / rate) + len * (tps % rate) / rate;
+	tickValid = false;
+	lastInterval = 0;
+
+	capture_setup_desc(0);
+	capture_setup_desc(1);
+
+	/* The first two descriptors are loaded before any block completes */
+	blockLimit = blocks;
+	if (blocks == 1 || blocks == 2) {
+		captureDesc[blocks - 1].xfercfg &= ~DMA_XFERCFG_RELOAD;
+	}
+
+	readyMask = 0;
+	nextBlock = 0;
+	conversions = 0;
+
+	/* Block 0 goes to the channel registers, it reloads block 1 when done */
+	Chip_DMA_SetupTranChannel(LPC_DMA, CAPTURE_DMA_CH, &captureDesc[0]);
+	Chip_DMA_SetupChannelTransfer(LPC_DMA, CAPTURE_DMA_CH, captureDesc[0].xfercfg);
+	Chip_DMA_EnableChannel(LPC_DMA, CAPTURE_DMA_CH);
+
+	/* The DMA is edge triggered, a result completed while the channel was
+	   off would hold the request high and block all further transfers */
+	Chip_ADC_GetSequencerDataReg(LPC_ADC, ADC_SEQA_IDX);
+}
+
+/* Stop filling sample blocks */
+void capture_stop(void)
+{
+	Chip_DMA_DisableChannel(LPC_DMA, CAPTURE_DMA_CH);
+	while (Chip_DMA_GetBusyChannels(LPC_DMA) & (1 << CAPTURE_DMA_CH)) {}
+	Chip_DMA_AbortChannel(LPC_DMA, CAPTURE_DMA_CH);
+
+	Chip_DMA_ClearActiveIntAChannel(LPC_DMA, CAPTURE_DMA_CH);
+	Chip_DMA_ClearActiveIntBChannel(LPC_DMA, CAPTURE_DMA_CH);
+	Chip_DMA_ClearErrorIntChannel(LPC_DMA, CAPTURE_DMA_CH);
+	readyMask = 0;
+	dmaError = false;
+}
+
+/* Tell capture whether blocks complete at the nominal rate */
+void capture_set_free_running(bool enable)
+{
+	freeRunning = enable;
+}
+
+/* Get the oldest completed sample block */
+const uint32_t *capture_get_block(void)
+{
+	/* The channel stopped, blocks in flight are lost */
+	if (dmaError) {
+		capture_start_blocks(blockLen, blockLimit);
+		return NULL;
+	}
+	if (readyMask & (1 << nextBlock)) {
+		return captureBuf[nextBlock];
+	}
+	return NULL;
+}
+
+/* Get the timestamp of the block from capture_get_block() */
+uint32_t capture_block_tick(void)
+{
+	return captureTick[nextBlock];
+}
+
+/* Get the sample index of the block from capture_get_block() */
+uint32_t capture_block_index(void)
+{
+	return captureIndex[nextBlock];
+}
+
+/* Return the block from capture_get_block() to the DMA */
+void capture_release_block(void)
+{
+	/* enter critical section */
+	NVIC_DisableIRQ(DMA_IRQn);
+	readyMask &= ~(1 << nextBlock);
+	/* exit critical section */
+	NVIC_EnableIRQ(DMA_IRQn);
+
+	nextBlock ^= 1;
+}
+
+/* Get the number of samples in each block */
+uint32_t capture_block_len(void)
+{
+	return blockLen;
+}
+
+/* Get the sample rate achieved by the ADC */
+uint32_t capture_measured_rate(void)
+{
+	uint32_t interval = lastInterval;
+
+	if (interval == 0) {
+		return 0;
+	}
+	return (blockLen * StopWatch_TicksPerSecond() + interval / 2) / interval;
+}
+
+/* Get the number of blocks overwritten before they were released */
+uint32_t capture_overflows(void)
+{
+	return overflows;
+}
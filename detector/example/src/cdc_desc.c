@@ -55,7 +55,7 @@ ALIGNED(4) const uint8_t USB_DeviceDescriptor[] = {
 	WBVAL(0x0100),						/* bcdDevice */
 	0x01,								/* iManufacturer */
 	0x02,								/* iProduct */
-	0x04,								/* iSerialNumber */
+	USB_SERIAL_STRING_IDX,				/* iSerialNumber */
 	0x01								/* bNumConfigurations */
 };
 
@@ -163,8 +163,9 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 
 /**
  * USB String Descriptor (optional)
+ * Kept in RAM, the serial number is filled in from the device UID
  */
-ALIGNED(4) const uint8_t USB_StringDescriptor[] = {
+ALIGNED(4) uint8_t USB_StringDescriptor[] = {
 	/* Index 0x00: LANGID Codes */
 	0x04,								/* bLength */
 	USB_STRING_DESCRIPTOR_TYPE,			/* bDescriptorType */
@@ -187,15 +188,17 @@ ALIGNED(4) const uint8_t USB_StringDescriptor[] = {
 	'o', 0,
 	'r', 0,
 	't', 0,
-	/* Index 0x03: Serial Number */
-	(6 * 2 + 2),						/* bLength (6 Char + Type + length) */
+	/* Index 0x03: Serial Number, UID in hex */
+	(USB_SERIAL_STRING_LEN * 2 + 2),	/* bLength (32 Char + Type + length) */
 	USB_STRING_DESCRIPTOR_TYPE,			/* bDescriptorType */
-	'N', 0,
-	'X', 0,
-	'P', 0,
-	'-', 0,
-	'7', 0,
-	'7', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
+	'0', 0, '0', 0, '0', 0, '0', 0,
 	/* Index 0x04: Interface 1, Alternate Setting 0 */
 	( 4 * 2 + 2),						/* bLength (4 Char + Type + length) */
 	USB_STRING_DESCRIPTOR_TYPE,			/* bDescriptorType */
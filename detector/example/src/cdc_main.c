@@ -33,15 +33,15 @@
 #include <stdio.h>
 #include <string.h>
 #include "app_usbd_cfg.h"
+#include "stopwatch.h"
 #include "cdc_vcom.h"
-
-#define TICKRATE_HZ (100)	/* 100 ticks per second */
-#define ADC_SAMPLE_COUNTER 2 /* Tick to trigger ADC */
-
-#define BOARD_ADC_CH 1
-
-static volatile int ticks;
-static bool sequenceComplete, thresholdCrossed;
+#include "stream.h"
+#include "measure.h"
+#include "command.h"
+#include "calib.h"
+#include "ident.h"
+#include "lowpower.h"
+#include "usbsync.h"
 
 static USBD_HANDLE_T g_hUsb;
 static uint8_t g_rxBuff[256];
@@ -56,48 +56,6 @@ const  USBD_API_T *g_pUsbApi;
  * Public functions
  ****************************************************************************/
 
-/**
- * @brief	Handle interrupt from SysTick timer
- * @return	Nothing
- */
-void SysTick_Handler(void)
-{
-	static uint32_t count;
-
-	count++;
-	if (count >= ADC_SAMPLE_COUNTER) {
-		count = 0;
-
-		/* Manual start for ADC conversion sequence A */
-		Chip_ADC_StartSequencer(LPC_ADC, ADC_SEQA_IDX);
-	}
-}
-
-/**
- * @brief	Handle interrupt from ADC sequencer A
- * @return	Nothing
- */
-void ADCA_IRQHandler(void)
-{
-	uint32_t pending;
-
-	/* Get pending interrupts */
-	pending = Chip_ADC_GetFlags(LPC_ADC);
-
-	/* Sequence A completion interrupt */
-	if (pending & ADC_FLAGS_SEQA_INT_MASK) {
-		sequenceComplete = true;
-	}
-
-	/* Threshold crossing interrupt on ADC input channel */
-	if (pending & ADC_FLAGS_THCMP_MASK(BOARD_ADC_CH)) {
-		thresholdCrossed = true;
-	}
-
-	/* Clear any pending interrupts */
-	Chip_ADC_ClearFlags(LPC_ADC, pending);
-}
-
 /**
  * @brief	Handle interrupt from USB0
  * @return	Nothing
@@ -106,6 +64,11 @@ void USB_IRQHandler(void)
 {
 	uint32_t *addr = (uint32_t *) LPC_USB->EPLISTSTART;
 
+	/* Latch the SOF time first, the ROM driver clears the flag */
+	if (LPC_USB->INTSTAT & USBSYNC_FRAME_INT) {
+		usbsync_sof();
+	}
+
 	/*	WORKAROUND for artf32289 ROM driver BUG:
 	    As part of USB specification the device should respond
 	    with STALL condition for any unsupported setup packet. The host will send
@@ -154,7 +117,6 @@ USB_INTERFACE_DESCRIPTOR *find_IntfDesc(const uint8_t *pDesc, uint32_t intfClass
  */
 int main(void)
 {
-	uint32_t rawSample;
 	USBD_API_INIT_PARAM_T usb_param;
 	USB_CORE_DESCS_T desc;
 	ErrorCode_t ret = LPC_OK;
@@ -164,47 +126,21 @@ int main(void)
 	/* Initialize board and chip */
 	Board_Init();
 
-	/* Configure T_ADJ(PIO0_16) pin as output */
-	Chip_GPIO_SetPinDIROutput(LPC_GPIO, 0, 16);
-	Chip_GPIO_SetPinState(LPC_GPIO, 0, 16, false);
-
-	/* Setup ADC for 12-bit mode and normal power */
-	Chip_ADC_Init(LPC_ADC, 0);
+	/* Unused peripherals stay unclocked */
+	lowpower_init();
 
-	/* Need to do a calibration after initialization and trim */
-	Chip_ADC_StartCalibration(LPC_ADC);
-	while (!(Chip_ADC_IsCalibrationDone(LPC_ADC))) {}
+	/* Free running device tick and sample frame protocol */
+	StopWatch_Init();
+	stream_init();
 
-	/* Setup ADC clock rate using sycnchronous clocking */
-	Chip_ADC_SetClockRate(LPC_ADC, 1000000);
+	/* Load the sensor calibration, uses the CRC engine */
+	calib_init();
 
-	/* Setup a sequencer to do the following:
-	   Perform ADC conversion of ADC channels 1 only */
-	Chip_ADC_SetupSequencer(LPC_ADC, ADC_SEQA_IDX,
-		(ADC_SEQ_CTRL_CHANSEL(BOARD_ADC_CH) | ADC_SEQ_CTRL_MODE_EOS));
+	/* Setup sampling, T_ADJ output and streaming */
+	measure_init();
 
-	/* ADC input 1 is on PIO0_23 mapped to FUNC2 */
-	Chip_IOCON_PinMuxSet(LPC_IOCON, 0, 23, (IOCON_FUNC1 | IOCON_MODE_INACT |
-										   IOCON_ADMODE_EN));
-	/* Use higher voltage trim */
-	Chip_ADC_SetTrim(LPC_ADC, ADC_TRIM_VRANGE_HIGHV);
-
-	/* Clear all pending interrupts */
-	Chip_ADC_ClearFlags(LPC_ADC, Chip_ADC_GetFlags(LPC_ADC));
-
-	/* Enable ADC overrun and sequence A completion interrupts */
-	Chip_ADC_EnableInt(LPC_ADC, (ADC_INTEN_SEQA_ENABLE | ADC_INTEN_OVRRUN_ENABLE));
-
-	/* Enable ADC NVIC interrupt */
-	NVIC_EnableIRQ(ADC_A_IRQn);
-
-	/* Enable sequencer */
-	Chip_ADC_EnableSequencer(LPC_ADC, ADC_SEQA_IDX);
-
-	/* This example uses the periodic sysTick to manually trigger the ADC,
-	   but a periodic timer can be used in a match configuration to start
-	   an ADC sequence without software intervention. */
-	SysTick_Config(SystemCoreClock / TICKRATE_HZ);
+	/* The serial number string is the chip UID */
+	ident_init();
 
 	/* enable clocks and pinmux */
 	Chip_USB_Init();
@@ -226,6 +162,9 @@ int main(void)
 	usb_param.max_num_ep = 3 + 1;
 	usb_param.mem_base = USB_STACK_MEM_BASE;
 	usb_param.mem_size = USB_STACK_MEM_SIZE;
+	usb_param.USB_Reset_Event = vcom_usb_reset;
+	usb_param.USB_Suspend_Event = lowpower_usb_suspend;
+	usb_param.USB_Resume_Event = lowpower_usb_resume;
 
 	/* Set the USB descriptors */
 	desc.device_desc = (uint8_t *) &USB_DeviceDescriptor[0];
@@ -251,6 +190,9 @@ int main(void)
 		/* Init VCOM interface */
 		ret = vcom_init(g_hUsb, &desc, &usb_param);
 		if (ret == LPC_OK) {
+			/* SOF interrupt is the time reference between detectors, it only
+			   runs while streaming */
+			usbsync_init(g_hUsb);
 			/*  enable USB interrupts */
 			NVIC_EnableIRQ(USB0_IRQn);
 			/* now connect */
@@ -261,29 +203,25 @@ int main(void)
 
 	while (1) {
 		if (vcom_connected()) {
-			if ((rdCnt = vcom_bread(&g_rxBuff[0], 256))) {
-				//Set TADJ pin high/low
-				if (g_rxBuff[0] == 0xF0) {
-					Chip_GPIO_SetPinState(LPC_GPIO, 0, 16, false);
-				} else if (g_rxBuff[0] == 0xF1) {
-					Chip_GPIO_SetPinState(LPC_GPIO, 0, 16, true);
-				} else if (g_rxBuff[0] == 0xF2) {
-					Board_LED_Set(0, false);
-				} else if (g_rxBuff[0] == 0xF3) {
-					Board_LED_Set(0, true);
-				}
-
+			/* Execute every command in the received data, the rest stays
+			   in the VCOM buffer while the parser can not take it */
+			command_poll();
+			rdCnt = command_space();
+			if (rdCnt > sizeof(g_rxBuff)) {
+				rdCnt = sizeof(g_rxBuff);
 			}
-			/* Is a conversion sequence complete? */
-			if (sequenceComplete) {
-				sequenceComplete = false;
-
-				rawSample = ADC_DR_RESULT(Chip_ADC_GetDataReg(LPC_ADC, 1));
-				vcom_write((uint8_t*)&rawSample, 2);
+			if ((rdCnt = vcom_bread(&g_rxBuff[0], rdCnt))) {
+				command_input(g_rxBuff, rdCnt);
+			}
+			/* Send any completed sample blocks */
+			measure_poll();
+			/* Map USB frames to device ticks for the sample stream */
+			if (measure_is_streaming()) {
+				usbsync_poll();
 			}
 		}
 
-		/* Sleep until next IRQ happens */
-		__WFI();
+		/* Sleep until next IRQ happens, deep-sleep while the bus is suspended */
+		lowpower_idle();
 	}
 }
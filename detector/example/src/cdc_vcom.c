@@ -37,6 +37,12 @@
  * Private types/enumerations/variables
  ****************************************************************************/
 
+static VCOM_TX_PKT_T g_txQueue[VCOM_TX_QUEUE_LEN];
+
+/* DTR bit of the last SET_CONTROL_LINE_STATE request */
+#define VCOM_LINE_STATE_DTR _BIT(0)
+static uint16_t lineState;
+
 /*****************************************************************************
  * Public types/enumerations/variables
  ****************************************************************************/
@@ -50,13 +56,40 @@ VCOM_DATA_T g_vCOM;
  * Private functions
  ****************************************************************************/
 
+/* Start the next queued IN transfer, must be called with USB IRQ masked */
+static void VCOM_tx_next(VCOM_DATA_T *pVcom)
+{
+	VCOM_TX_PKT_T *pkt;
+	uint32_t n;
+
+	/* A packet is sent from the queue and stays there until it is done */
+	if (pVcom->tx_flags & VCOM_TX_BUSY) {
+		spsc_release(&pVcom->tx_ring, 1);
+	}
+
+	/* Packets queued before the host connected are dropped */
+	if (pVcom->tx_flags & VCOM_TX_FLUSH) {
+		pVcom->tx_flags &= ~VCOM_TX_FLUSH;
+		spsc_release(&pVcom->tx_ring, pVcom->tx_flush - pVcom->tx_ring.tail);
+	}
+
+	pkt = spsc_read_span(&pVcom->tx_ring, &n);
+	if (n > 0) {
+		pVcom->tx_flags |= VCOM_TX_BUSY;
+		USBD_API->hw->WriteEP(pVcom->hUsb, USB_CDC_IN_EP, pkt->data, pkt->len);
+	}
+	else {
+		pVcom->tx_flags &= ~VCOM_TX_BUSY;
+	}
+}
+
 /* VCOM bulk EP_IN endpoint handler */
 static ErrorCode_t VCOM_bulk_in_hdlr(USBD_HANDLE_T hUsb, void *data, uint32_t event)
 {
 	VCOM_DATA_T *pVcom = (VCOM_DATA_T *) data;
 
 	if (event == USB_EVT_IN) {
-		pVcom->tx_flags &= ~VCOM_TX_BUSY;
+		VCOM_tx_next(pVcom);
 	}
 	return LPC_OK;
 }
@@ -97,13 +130,40 @@ static ErrorCode_t VCOM_bulk_out_hdlr(USBD_HANDLE_T hUsb, void *data, uint32_t e
 	return LPC_OK;
 }
 
+/* Drop the queued IN packets and set the connection state */
+static void VCOM_tx_drop(VCOM_DATA_T *pVcom, uint16_t connected)
+{
+	if (pVcom->tx_flags & VCOM_TX_BUSY) {
+		/* The packet in flight is released by its IN event, the rest of the
+		   queue goes with it */
+		pVcom->tx_flush = pVcom->tx_ring.head;
+		pVcom->tx_flags = connected | VCOM_TX_BUSY | VCOM_TX_FLUSH;
+	}
+	else {
+		pVcom->tx_flags = connected;	/* reset other flags */
+		spsc_flush(&pVcom->tx_ring);
+	}
+}
+
 /* Set line coding call back routine */
 static ErrorCode_t VCOM_SetLineCode(USBD_HANDLE_T hCDC, CDC_LINE_CODING *line_coding)
 {
-	VCOM_DATA_T *pVcom = &g_vCOM;
-
 	/* Called when baud rate is changed/set. Using it to know host connection state */
-	pVcom->tx_flags = VCOM_TX_CONNECTED;	/* reset other flags */
+	VCOM_tx_drop(&g_vCOM, VCOM_TX_CONNECTED);
+
+	return LPC_OK;
+}
+
+/* Set control line state call back routine */
+static ErrorCode_t VCOM_SetCtrlLineState(USBD_HANDLE_T hCDC, uint16_t state)
+{
+	/* The host drops DTR when the port is closed. Only a falling edge
+	   disconnects, a host that never raises DTR still connects through
+	   the line coding. */
+	if ((lineState & VCOM_LINE_STATE_DTR) && !(state & VCOM_LINE_STATE_DTR)) {
+		VCOM_tx_drop(&g_vCOM, 0);
+	}
+	lineState = state;
 
 	return LPC_OK;
 }
@@ -120,12 +180,14 @@ ErrorCode_t vcom_init(USBD_HANDLE_T hUsb, USB_CORE_DESCS_T *pDesc, USBD_API_INIT
 	uint32_t ep_indx;
 
 	g_vCOM.hUsb = hUsb;
+	spsc_init(&g_vCOM.tx_ring, g_txQueue, sizeof(VCOM_TX_PKT_T), VCOM_TX_QUEUE_LEN);
 	memset((void *) &cdc_param, 0, sizeof(USBD_CDC_INIT_PARAM_T));
 	cdc_param.mem_base = pUsbParam->mem_base;
 	cdc_param.mem_size = pUsbParam->mem_size;
 	cdc_param.cif_intf_desc = (uint8_t *) find_IntfDesc(pDesc->high_speed_desc, CDC_COMMUNICATION_INTERFACE_CLASS);
 	cdc_param.dif_intf_desc = (uint8_t *) find_IntfDesc(pDesc->high_speed_desc, CDC_DATA_INTERFACE_CLASS);
 	cdc_param.SetLineCode = VCOM_SetLineCode;
+	cdc_param.SetCtrlLineState = VCOM_SetCtrlLineState;
 
 	ret = USBD_API->cdc->init(hUsb, &cdc_param, &g_vCOM.hCdc);
 
@@ -152,6 +214,16 @@ ErrorCode_t vcom_init(USBD_HANDLE_T hUsb, USB_CORE_DESCS_T *pDesc, USBD_API_INIT
 	return ret;
 }
 
+/* USB bus reset event handler */
+ErrorCode_t vcom_usb_reset(USBD_HANDLE_T hUsb)
+{
+	g_vCOM.tx_flags = 0;
+	spsc_flush(&g_vCOM.tx_ring);
+	lineState = 0;
+
+	return LPC_OK;
+}
+
 /* Virtual com port buffered read routine */
 uint32_t vcom_bread(uint8_t *pBuf, uint32_t buf_len)
 {
@@ -159,8 +231,9 @@ uint32_t vcom_bread(uint8_t *pBuf, uint32_t buf_len)
 	uint16_t cnt = 0;
 	/* read from the default buffer if any data present */
 	if (pVcom->rx_count) {
-		cnt = (pVcom->rx_count < buf_len) ? pVcom->rx_count : buf_len;
-		memcpy(pBuf, pVcom->rx_buff, cnt);
+		cnt = pVcom->rx_count - pVcom->rx_rd_count;
+		cnt = (cnt < buf_len) ? cnt : buf_len;
+		memcpy(pBuf, &pVcom->rx_buff[pVcom->rx_rd_count], cnt);
 		pVcom->rx_rd_count += cnt;
 
 		/* enter critical section */
@@ -213,17 +286,38 @@ uint32_t vcom_read_cnt(void)
 uint32_t vcom_write(uint8_t *pBuf, uint32_t len)
 {
 	VCOM_DATA_T *pVcom = &g_vCOM;
-	uint32_t ret = 0;
+	VCOM_TX_PKT_T *pkt;
+	uint32_t i, n, npkts = (len + USB_FS_MAX_BULK_PACKET - 1) / USB_FS_MAX_BULK_PACKET;
+	uint32_t ret = len;
 
-	if ( (pVcom->tx_flags & VCOM_TX_CONNECTED) && ((pVcom->tx_flags & VCOM_TX_BUSY) == 0) ) {
-		pVcom->tx_flags |= VCOM_TX_BUSY;
+	if ((pVcom->tx_flags & VCOM_TX_CONNECTED) == 0) {
+		return 0;
+	}
+	if (vcom_tx_free() < npkts) {
+		pVcom->tx_dropped += len;
+		return 0;
+	}
 
-		/* enter critical section */
-		NVIC_DisableIRQ(USB0_IRQn);
-		ret = USBD_API->hw->WriteEP(pVcom->hUsb, USB_CDC_IN_EP, pBuf, len);
-		/* exit critical section */
-		NVIC_EnableIRQ(USB0_IRQn);
+	/* Only this routine inserts, so the free space checked above stays.
+	   Packets are filled in place, at most two spans at the wrap. */
+	while (len > 0) {
+		pkt = spsc_write_span(&pVcom->tx_ring, &n);
+		for (i = 0; i < n && len > 0; i++) {
+			pkt[i].len = (len < USB_FS_MAX_BULK_PACKET) ? len : USB_FS_MAX_BULK_PACKET;
+			memcpy(pkt[i].data, pBuf, pkt[i].len);
+			pBuf += pkt[i].len;
+			len -= pkt[i].len;
+		}
+		spsc_commit(&pVcom->tx_ring, i);
 	}
 
+	/* enter critical section */
+	NVIC_DisableIRQ(USB0_IRQn);
+	if ((pVcom->tx_flags & VCOM_TX_BUSY) == 0) {
+		VCOM_tx_next(pVcom);
+	}
+	/* exit critical section */
+	NVIC_EnableIRQ(USB0_IRQn);
+
 	return ret;
 }
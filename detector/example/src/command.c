@@ -0,0 +1,421 @@
+/*
+ * @brief Host command protocol
+ *
+ * @note
+ * Received bytes are collected in a command buffer. Bytes that cannot start
+ * a valid command, and commands failing the CRC check, are discarded one
+ * byte at a time so the parser finds the next sync byte. A partial command
+ * whose rest does not arrive within CMD_TIMEOUT_MS is discarded the same
+ * way, so a false sync byte can not hold up the parser. An acknowledge that
+ * does not fit the TX queue is held, and no further command is executed
+ * until it has been sent.
+ */
+#include <stddef.h>
+#include <string.h>
+#include "board.h"
+#include "stopwatch.h"
+#include "cdc_vcom.h"
+#include "sampler.h"
+#include "capture.h"
+#include "filter.h"
+#include "stats.h"
+#include "power.h"
+#include "calib.h"
+#include "stream.h"
+#include "measure.h"
+#include "ident.h"
+#include "health.h"
+#include "extrig.h"
+#include "sequencer.h"
+#include "encode.h"
+#include "command.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define CMD_CRC_LEN             2
+#define CMD_BUF_SZ              (sizeof(CMD_HDR_T) + CMD_MAX_PAYLOAD + CMD_CRC_LEN)
+#define CMD_TIMEOUT_MS          100		/* Longest gap within a command */
+
+static uint8_t cmdBuf[CMD_BUF_SZ];
+static uint32_t cmdCount;
+static uint32_t rxTick;
+static uint32_t rxErrors;
+
+/* Acknowledge payload, ackLen is 0 unless one is waiting for the TX queue */
+static uint8_t ackBuf[STREAM_MAX_PAYLOAD];
+static uint32_t ackLen;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static uint32_t get_u16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* Drop bytes from the start of the command buffer */
+static void command_consume(uint32_t n)
+{
+	cmdCount -= n;
+	memmove(cmdBuf, &cmdBuf[n], cmdCount);
+}
+
+/* Fill in the status reply, reply is not word aligned */
+static uint32_t command_status(uint8_t *reply)
+{
+	CMD_STATUS_T status;
+
+	status.rate = sampler_get_rate();
+	status.max_rate = sampler_max_rate();
+	status.average = filter_get_average();
+	status.mode = measure_get_mode();
+	status.flags = (measure_is_streaming() ? CMD_STATUS_STREAMING : 0) |
+				   (measure_get_tadj() ? CMD_STATUS_TADJ : 0) |
+				   (measure_is_power_output() ? CMD_STATUS_POWER : 0) |
+				   (calib_is_stored() ? CMD_STATUS_CALIB : 0) |
+				   (measure_is_tadj_auto() ? CMD_STATUS_TADJ_AUTO : 0);
+	status.overflows = capture_overflows();
+	status.tx_dropped = vcom_tx_dropped();
+	status.rx_errors = rxErrors;
+	status.smoothing = filter_get_smoothing();
+	status.frac_bits = FILTER_FRAC_BITS;
+	status.reserved = 0;
+	status.window = stats_get_window();
+	status.tick_rate = StopWatch_TicksPerSecond();
+	status.frequency = power_get_frequency();
+	memcpy(status.uid, ident_get_uid(), sizeof(status.uid));
+	status.calib_crc = calib_get_crc();
+	status.reserved2 = 0;
+	status.adc_overruns = health_adc_overruns();
+	status.dma_errors = health_dma_errors();
+	status.block_jitter = health_block_jitter_max();
+	status.achieved_rate = capture_measured_rate();
+	status.profile = sampler_get_profile();
+	status.missed_triggers = extrig_missed();
+	status.steps_done = sequencer_steps_done();
+	status.tadj_switches = measure_tadj_switches();
+	status.tadj_tick = measure_tadj_tick();
+	status.sync = sampler_get_sync();
+	status.encoding = encode_get_mode();
+	memcpy(reply, &status, sizeof(status));
+
+	return sizeof(status);
+}
+
+/* Execute one command, returns the result code and sets the reply length */
+static CMD_RESULT_T command_execute(uint8_t op, const uint8_t *arg, uint32_t len,
+									uint8_t *reply, uint32_t *replyLen)
+{
+	uint32_t val;
+
+	*replyLen = 0;
+	switch (op) {
+	case CMD_OP_PING:
+		return CMD_OK;
+
+	case CMD_OP_GET_STATUS:
+		*replyLen = command_status(reply);
+		return CMD_OK;
+
+	case CMD_OP_SET_RATE:
+		if (len != 4) {
+			return CMD_ERR_LENGTH;
+		}
+		val = measure_set_rate(get_u32(arg));
+		memcpy(reply, &val, 4);
+		*replyLen = 4;
+		return CMD_OK;
+
+	case CMD_OP_SET_AVERAGE:
+		if (len != 2) {
+			return CMD_ERR_LENGTH;
+		}
+		val = measure_set_average(get_u16(arg));
+		memcpy(reply, &val, 2);
+		*replyLen = 2;
+		return CMD_OK;
+
+	case CMD_OP_SET_TADJ:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		if (arg[0] > 2) {
+			return CMD_ERR_PARAM;
+		}
+		if (arg[0] == 2) {
+			measure_set_tadj_auto();
+		}
+		else {
+			measure_set_tadj(arg[0] != 0);
+		}
+		return CMD_OK;
+
+	case CMD_OP_STREAM:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		measure_set_streaming(arg[0] != 0);
+		return CMD_OK;
+
+	case CMD_OP_SET_MODE:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		return measure_set_mode(arg[0]) ? CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_SET_LED:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		Board_LED_Set(0, arg[0] != 0);
+		return CMD_OK;
+
+	case CMD_OP_SET_SMOOTHING:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		reply[0] = measure_set_smoothing(arg[0]);
+		*replyLen = 1;
+		return CMD_OK;
+
+	case CMD_OP_SET_WINDOW:
+		if (len != 4) {
+			return CMD_ERR_LENGTH;
+		}
+		val = measure_set_window(get_u32(arg));
+		memcpy(reply, &val, 4);
+		*replyLen = 4;
+		return CMD_OK;
+
+	case CMD_OP_SET_TRIGGER:
+		if (len != sizeof(CMD_TRIGGER_T)) {
+			return CMD_ERR_LENGTH;
+		}
+		return measure_set_trigger(get_u16(&arg[offsetof(CMD_TRIGGER_T, level)]),
+								   arg[offsetof(CMD_TRIGGER_T, falling)] != 0,
+								   get_u16(&arg[offsetof(CMD_TRIGGER_T, pre)]),
+								   get_u16(&arg[offsetof(CMD_TRIGGER_T, post)])) ? CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_SET_EXT_TRIGGER:
+		if (len != sizeof(CMD_EXT_TRIGGER_T)) {
+			return CMD_ERR_LENGTH;
+		}
+		return measure_set_ext_trigger(arg[offsetof(CMD_EXT_TRIGGER_T, falling)] != 0,
+									   get_u16(&arg[offsetof(CMD_EXT_TRIGGER_T, settle)])) ?
+			   CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_SET_SEQUENCE:
+		if (len != sizeof(CMD_SEQUENCE_T)) {
+			return CMD_ERR_LENGTH;
+		}
+		return measure_set_sequence(get_u32(&arg[offsetof(CMD_SEQUENCE_T, settle)]),
+									get_u16(&arg[offsetof(CMD_SEQUENCE_T, samples)]),
+									get_u32(&arg[offsetof(CMD_SEQUENCE_T, steps)])) ?
+			   CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_LOAD_SWEEP:
+		return measure_load_sweep(arg, len) ? CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_SET_FREQUENCY:
+		if (len != 2) {
+			return CMD_ERR_LENGTH;
+		}
+		val = get_u16(arg);
+		if (val > POWER_MAX_FREQ) {
+			return CMD_ERR_PARAM;
+		}
+		measure_set_frequency(val);
+		return CMD_OK;
+
+	case CMD_OP_SET_OUTPUT:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		measure_set_power_output(arg[0] != 0);
+		return CMD_OK;
+
+	case CMD_OP_SET_SYNC:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		return measure_set_sync(arg[0]) ? CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_SET_ENCODING:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		return encode_set_mode(arg[0]) ? CMD_OK : CMD_ERR_PARAM;
+
+	case CMD_OP_WRITE_CALIB:
+		switch (calib_write(arg, len)) {
+		case CALIB_OK:
+			return CMD_OK;
+
+		case CALIB_ERR_INVALID:
+			return CMD_ERR_PARAM;
+
+		default:
+			return CMD_ERR_FAILED;
+		}
+
+	case CMD_OP_READ_CALIB:
+		if (len != 4) {
+			return CMD_ERR_LENGTH;
+		}
+		val = get_u16(&arg[2]);
+		if (val > STREAM_MAX_PAYLOAD - sizeof(CMD_ACK_T)) {
+			return CMD_ERR_PARAM;
+		}
+		*replyLen = calib_read(get_u16(arg), reply, val);
+		return CMD_OK;
+
+	case CMD_OP_SET_PROFILE:
+		if (len != 1) {
+			return CMD_ERR_LENGTH;
+		}
+		if (arg[0] & ~SAMPLER_PROFILE_MASK) {
+			return CMD_ERR_PARAM;
+		}
+		val = measure_set_profile(arg[0]);
+		memcpy(reply, &val, 4);
+		*replyLen = 4;
+		return CMD_OK;
+
+	default:
+		return CMD_ERR_UNKNOWN;
+	}
+}
+
+/* Send the pending acknowledge, returns false if it is still pending */
+static bool command_send_ack(void)
+{
+	if (ackLen > 0) {
+		/* Acknowledges are never dropped while the host is connected */
+		if (vcom_connected() &&
+			!stream_send(STREAM_TYPE_ACK, 0, StopWatch_Start(), 0, ackBuf, ackLen)) {
+			return false;
+		}
+		ackLen = 0;
+	}
+	return true;
+}
+
+/* Execute a command and queue its acknowledge */
+static void command_dispatch(uint8_t op, const uint8_t *arg, uint32_t len)
+{
+	CMD_ACK_T *ack = (CMD_ACK_T *) ackBuf;
+	uint32_t replyLen;
+
+	ack->op = op;
+	ack->result = command_execute(op, arg, len, &ackBuf[sizeof(CMD_ACK_T)], &replyLen);
+	ackLen = sizeof(CMD_ACK_T) + replyLen;
+	command_send_ack();
+}
+
+/* Execute the complete commands in the buffer, stops at a partial command
+   or an acknowledge waiting for the TX queue */
+static void command_parse(void)
+{
+	uint32_t size, payloadLen;
+
+	while (cmdCount > 0 && ackLen == 0) {
+		if (cmdBuf[0] != CMD_SYNC) {
+			rxErrors++;
+			command_consume(1);
+			continue;
+		}
+		if (cmdCount < sizeof(CMD_HDR_T)) {
+			break;
+		}
+		payloadLen = get_u16(&cmdBuf[offsetof(CMD_HDR_T, len)]);
+		if (payloadLen > CMD_MAX_PAYLOAD) {
+			rxErrors++;
+			command_consume(1);
+			continue;
+		}
+		size = sizeof(CMD_HDR_T) + payloadLen;
+		if (cmdCount < size + CMD_CRC_LEN) {
+			break;
+		}
+		if (stream_crc16(cmdBuf, size) != get_u16(&cmdBuf[size])) {
+			rxErrors++;
+			command_consume(1);
+			continue;
+		}
+
+		command_dispatch(cmdBuf[offsetof(CMD_HDR_T, op)],
+						 &cmdBuf[sizeof(CMD_HDR_T)], payloadLen);
+		command_consume(size + CMD_CRC_LEN);
+	}
+}
+
+/* Drop a partial command whose rest did not arrive in time */
+static void command_expire(void)
+{
+	/* Resync from the next byte, what is left is just as old */
+	while (cmdCount > 0 && ackLen == 0 &&
+		   StopWatch_Elapsed(rxTick) > StopWatch_MsToTicks(CMD_TIMEOUT_MS)) {
+		rxErrors++;
+		command_consume(1);
+		command_parse();
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Feed received bytes to the command parser */
+void command_input(const uint8_t *data, uint32_t len)
+{
+	uint32_t n = command_space();
+
+	/* More than command_space() is dropped */
+	if (len > n) {
+		rxErrors += len - n;
+		len = n;
+	}
+	memcpy(&cmdBuf[cmdCount], data, len);
+	cmdCount += len;
+	rxTick = StopWatch_Start();
+
+	command_parse();
+}
+
+/* Get the number of bytes command_input() can take */
+uint32_t command_space(void)
+{
+	return ackLen > 0 ? 0 : CMD_BUF_SZ - cmdCount;
+}
+
+/* Send a held acknowledge and drop a stale partial command */
+void command_poll(void)
+{
+	if (ackLen > 0) {
+		if (!command_send_ack()) {
+			return;
+		}
+		/* Input was held back, the timeout starts over */
+		rxTick = StopWatch_Start();
+		command_parse();
+	}
+	command_expire();
+}
+
+/* Get the number of bytes discarded by the command parser */
+uint32_t command_errors(void)
+{
+	return rxErrors;
+}
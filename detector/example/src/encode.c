@@ -0,0 +1,129 @@
+/*
+ * @brief Compact sample encodings
+ *
+ * @note
+ * Packing works in place, every output byte is written after the input
+ * bytes it overlaps were read. Delta coding can grow before it shrinks,
+ * so it goes through a scratch buffer and is only used if the whole block
+ * gets shorter.
+ */
+#include <string.h>
+#include "board.h"
+#include "filter.h"
+#include "capture.h"
+#include "encode.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t encodeMode;
+static uint8_t scratch[CAPTURE_BLOCK_MAX * sizeof(uint16_t)];
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Round a sample to a whole 12-bit result */
+static uint32_t encode_round12(uint16_t sample)
+{
+	uint32_t x = (sample + (1 << (FILTER_FRAC_BITS - 1))) >> FILTER_FRAC_BITS;
+
+	return x > 0xFFF ? 0xFFF : x;
+}
+
+/* Two samples in three bytes, an odd last sample in two */
+static uint32_t encode_pack12(const uint16_t *samples, uint32_t n, uint8_t *out)
+{
+	uint32_t i, a, b, len = 0;
+
+	for (i = 0; i + 1 < n; i += 2) {
+		a = encode_round12(samples[i]);
+		b = encode_round12(samples[i + 1]);
+		out[len++] = a;
+		out[len++] = (a >> 8) | (b << 4);
+		out[len++] = b >> 4;
+	}
+	if (i < n) {
+		a = encode_round12(samples[i]);
+		out[len++] = a;
+		out[len++] = a >> 8;
+	}
+	return len;
+}
+
+/* Zigzag varint deltas, 0 if they do not fit in max bytes */
+static uint32_t encode_delta(const uint16_t *samples, uint32_t n, uint8_t *out, uint32_t max)
+{
+	uint32_t i, z, size, len = 0;
+	int32_t d, prev = 0;
+
+	for (i = 0; i < n; i++) {
+		d = (int32_t) samples[i] - prev;
+		prev = samples[i];
+		z = d >= 0 ? (uint32_t) d << 1 : ((uint32_t) -d << 1) - 1;
+
+		/* At most 3 bytes for a 17-bit value */
+		size = z < 0x80 ? 1 : (z < 0x4000 ? 2 : 3);
+		if (len + size > max) {
+			return 0;
+		}
+		while (z >= 0x80) {
+			out[len++] = z | 0x80;
+			z >>= 7;
+		}
+		out[len++] = z;
+	}
+	return len;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Select the sample encoding */
+bool encode_set_mode(uint32_t mode)
+{
+	if (mode >= ENCODE_COUNT) {
+		return false;
+	}
+	encodeMode = mode;
+
+	return true;
+}
+
+/* Get the sample encoding */
+uint32_t encode_get_mode(void)
+{
+	return encodeMode;
+}
+
+/* Encode samples */
+uint32_t encode_samples(const uint16_t *samples, uint32_t n, uint8_t *out)
+{
+	uint32_t len;
+
+	if (n > CAPTURE_BLOCK_MAX) {
+		return 0;
+	}
+
+	switch (encodeMode) {
+	case ENCODE_PACK12:
+		/* A single sample takes two bytes either way */
+		return n > 1 ? encode_pack12(samples, n, out) : 0;
+
+	case ENCODE_DELTA:
+		len = encode_delta(samples, n, scratch, n * sizeof(uint16_t) - 1);
+		if (len > 0) {
+			memcpy(out, scratch, len);
+		}
+		return len;
+
+	default:
+		return 0;
+	}
+}
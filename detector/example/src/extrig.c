@@ -0,0 +1,171 @@
+/*
+ * @brief External trigger input
+ *
+ * @note
+ * The trigger pin goes through pin interrupt channel EXTRIG_PININT. CT16B0
+ * counts microseconds and stops on MAT0 at the end of the settle delay.
+ */
+#include "board.h"
+#include "stopwatch.h"
+#include "sampler.h"
+#include "sequencer.h"
+#include "extrig.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define EXTRIG_TIMER            LPC_TIMER16_0
+#define EXTRIG_MATCH            0
+#define EXTRIG_IRQ              ((IRQn_Type) (PIN_INT0_IRQn + EXTRIG_PININT))
+
+static bool fallingEdge;
+static uint32_t settleTime;
+
+static volatile bool armed;
+static volatile bool startSequencer;
+static volatile uint32_t edgeTick;
+static volatile uint32_t missed;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Enable the edge interrupt, the edge starts the sequencer or the sampler */
+static void extrig_enable(bool sequencer)
+{
+	Chip_TIMER_Disable(EXTRIG_TIMER);
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(EXTRIG_PININT));
+	startSequencer = sequencer;
+	armed = true;
+
+	if (fallingEdge) {
+		Chip_PININT_DisableIntHigh(LPC_PININT, PININTCH(EXTRIG_PININT));
+		Chip_PININT_EnableIntLow(LPC_PININT, PININTCH(EXTRIG_PININT));
+	}
+	else {
+		Chip_PININT_DisableIntLow(LPC_PININT, PININTCH(EXTRIG_PININT));
+		Chip_PININT_EnableIntHigh(LPC_PININT, PININTCH(EXTRIG_PININT));
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/**
+ * @brief	Handle interrupt from the trigger pin
+ * @return	Nothing
+ */
+void PIN_INT0_IRQHandler(void)
+{
+	uint32_t tick = StopWatch_Start();
+
+	Chip_PININT_ClearIntStatus(LPC_PININT, PININTCH(EXTRIG_PININT));
+	if (!armed) {
+		missed++;
+		return;
+	}
+	armed = false;
+	edgeTick = tick;
+
+	if (startSequencer) {
+		sequencer_start();
+	}
+	else if (settleTime == 0) {
+		sampler_run(true);
+	}
+	else {
+		Chip_TIMER_Reset(EXTRIG_TIMER);
+		Chip_TIMER_Enable(EXTRIG_TIMER);
+	}
+}
+
+/**
+ * @brief	Handle interrupt from the settle timer
+ * @return	Nothing
+ */
+void TIMER16_0_IRQHandler(void)
+{
+	Chip_TIMER_ClearMatch(EXTRIG_TIMER, EXTRIG_MATCH);
+	sampler_run(true);
+}
+
+/* Initialize the trigger pin and the settle timer */
+void extrig_init(void)
+{
+	/* GPIO input, the pin is a true open-drain I2C pin */
+	Chip_IOCON_PinMuxSet(LPC_IOCON, EXTRIG_PORT, EXTRIG_PIN,
+						 (IOCON_FUNC0 | IOCON_MODE_INACT | IOCON_STDI2C_EN));
+	Chip_GPIO_SetPinDIRInput(LPC_GPIO, EXTRIG_PORT, EXTRIG_PIN);
+
+	Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_PINT);
+	Chip_SYSCTL_SetPinInterrupt(EXTRIG_PININT, EXTRIG_PORT, EXTRIG_PIN);
+	Chip_PININT_SetPinModeEdge(LPC_PININT, PININTCH(EXTRIG_PININT));
+
+	/* One-shot microsecond timer */
+	Chip_TIMER_Init(EXTRIG_TIMER);
+	Chip_TIMER_Disable(EXTRIG_TIMER);
+	Chip_TIMER_Reset(EXTRIG_TIMER);
+	Chip_TIMER_PrescaleSet(EXTRIG_TIMER, Chip_Clock_GetSystemClockRate() / 1000000 - 1);
+	Chip_TIMER_MatchEnableInt(EXTRIG_TIMER, EXTRIG_MATCH);
+	Chip_TIMER_StopOnMatchEnable(EXTRIG_TIMER, EXTRIG_MATCH);
+	Chip_TIMER_ResetOnMatchEnable(EXTRIG_TIMER, EXTRIG_MATCH);
+
+	NVIC_EnableIRQ(TIMER_16_0_IRQn);
+	NVIC_EnableIRQ(EXTRIG_IRQ);
+}
+
+/* Configure the trigger */
+bool extrig_setup(bool falling, uint32_t settle)
+{
+	if (settle > EXTRIG_MAX_SETTLE) {
+		return false;
+	}
+	extrig_disarm();
+
+	fallingEdge = falling;
+	settleTime = settle;
+	/* The counter reaches the match value settle us after the reset, 0 is
+	   started from the edge interrupt without the timer */
+	Chip_TIMER_SetMatch(EXTRIG_TIMER, EXTRIG_MATCH, settle);
+
+	return true;
+}
+
+/* Wait for the next edge */
+void extrig_arm(void)
+{
+	extrig_enable(false);
+}
+
+/* Start the sequencer on the next edge */
+void extrig_arm_sequencer(void)
+{
+	extrig_enable(true);
+}
+
+/* Ignore the trigger input */
+void extrig_disarm(void)
+{
+	Chip_PININT_DisableIntHigh(LPC_PININT, PININTCH(EXTRIG_PININT));
+	Chip_PININT_DisableIntLow(LPC_PININT, PININTCH(EXTRIG_PININT));
+	Chip_TIMER_Disable(EXTRIG_TIMER);
+	armed = false;
+}
+
+/* Get the time of the last edge */
+uint32_t extrig_tick(void)
+{
+	return edgeTick;
+}
+
+/* Get the number of edges ignored during a measurement */
+uint32_t extrig_missed(void)
+{
+	return missed;
+}
@@ -0,0 +1,127 @@
+/*
+ * @brief Sample decimation filter
+ *
+ * @note
+ * A sum of FILTER_MAX_AVERAGE 12-bit results scaled by 2^FILTER_FRAC_BITS
+ * still fits in 32 bits. The only division is done once per output sample.
+ * The IIR smoother keeps its state with smoothing extra fractional bits,
+ * y += (x - y) / 2^smoothing, so no resolution is lost at long time
+ * constants.
+ */
+#include "board.h"
+#include "filter.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t average = 1;
+static uint32_t smoothing;
+static uint32_t accSum;
+static uint32_t accCount;
+
+/* IIR state, output scaled by 2^smoothing */
+static uint32_t iirState;
+static bool iirValid;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Run the IIR smoother on one decimated sample */
+static uint32_t filter_smooth(uint32_t x)
+{
+	if (!iirValid) {
+		/* Start from the first sample instead of zero */
+		iirState = x << smoothing;
+		iirValid = true;
+	}
+	else {
+		iirState = iirState - (iirState >> smoothing) + x;
+	}
+	return (iirState + ((1 << smoothing) >> 1)) >> smoothing;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Discard any partially accumulated output sample and IIR state */
+void filter_reset(void)
+{
+	accSum = 0;
+	accCount = 0;
+	iirValid = false;
+}
+
+/* Set the decimation ratio */
+uint32_t filter_set_average(uint32_t n)
+{
+	if (n == 0) {
+		n = 1;
+	}
+	else if (n > FILTER_MAX_AVERAGE) {
+		n = FILTER_MAX_AVERAGE;
+	}
+	average = n;
+	filter_reset();
+
+	return average;
+}
+
+/* Get the decimation ratio */
+uint32_t filter_get_average(void)
+{
+	return average;
+}
+
+/* Set the IIR smoother time constant */
+uint32_t filter_set_smoothing(uint32_t shift)
+{
+	if (shift > FILTER_MAX_SMOOTHING) {
+		shift = FILTER_MAX_SMOOTHING;
+	}
+	smoothing = shift;
+	filter_reset();
+
+	return smoothing;
+}
+
+/* Get the IIR smoother time constant */
+uint32_t filter_get_smoothing(void)
+{
+	return smoothing;
+}
+
+/* Reduce raw ADC results to output samples */
+uint32_t filter_process(const uint32_t *raw, uint32_t len, uint16_t *out)
+{
+	uint32_t i, x, cnt = 0;
+
+	for (i = 0; i < len; i++) {
+		accSum += ADC_DR_RESULT(raw[i]);
+		if (++accCount < average) {
+			continue;
+		}
+
+		/* Decimated sample with FILTER_FRAC_BITS fractional bits */
+		if (average == 1) {
+			x = accSum << FILTER_FRAC_BITS;
+		}
+		else {
+			x = ((accSum << FILTER_FRAC_BITS) + average / 2) / average;
+		}
+		accSum = 0;
+		accCount = 0;
+
+		if (smoothing > 0) {
+			x = filter_smooth(x);
+		}
+		out[cnt++] = x;
+	}
+	return cnt;
+}
@@ -0,0 +1,140 @@
+/*
+ * @brief Acquisition health counters
+ *
+ * @note
+ * ADC overruns are taken from the OVERRUN bit of each result, which is
+ * cheaper than an overrun interrupt at high sample rates. Capture overflows,
+ * VCOM drops and command errors are counted by their drivers, only changes
+ * are flagged here.
+ */
+#include "board.h"
+#include "cdc_vcom.h"
+#include "capture.h"
+#include "command.h"
+#include "health.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t adcOverruns;
+static volatile uint32_t dmaErrors;
+static volatile uint32_t blockJitterMax;
+
+/* Events not yet flagged in a frame */
+static volatile uint16_t pendingFlags;
+
+/* Driver counters when last flagged */
+static uint32_t lastOverflows;
+static uint32_t lastTxDropped;
+static uint32_t lastRxErrors;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Add pending flags, the DMA interrupt sets them too */
+static void health_set_flags(uint16_t flags)
+{
+	/* enter critical section */
+	NVIC_DisableIRQ(DMA_IRQn);
+	pendingFlags |= flags;
+	/* exit critical section */
+	NVIC_EnableIRQ(DMA_IRQn);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Check a captured block for ADC overruns */
+void health_check_block(const uint32_t *raw, uint32_t len)
+{
+	uint32_t n = 0;
+
+	while (len > 0) {
+		if (*raw & ADC_DR_OVERRUN) {
+			n++;
+		}
+		raw++;
+		len--;
+	}
+	if (n > 0) {
+		adcOverruns += n;
+		health_set_flags(HEALTH_FLAG_ADC_OVERRUN);
+	}
+}
+
+/* Count a DMA error */
+void health_dma_error(void)
+{
+	dmaErrors++;
+	pendingFlags |= HEALTH_FLAG_DMA_ERROR;
+}
+
+/* Record how much a block interval exceeded the nominal one */
+void health_block_jitter(uint32_t ticks)
+{
+	if (ticks > blockJitterMax) {
+		blockJitterMax = ticks;
+	}
+}
+
+/* Get the flags for the next frame */
+uint16_t health_get_flags(void)
+{
+	uint16_t flags = pendingFlags;
+
+	if (capture_overflows() != lastOverflows) {
+		flags |= HEALTH_FLAG_OVERFLOW;
+	}
+	if (vcom_tx_dropped() != lastTxDropped) {
+		flags |= HEALTH_FLAG_TX_DROPPED;
+	}
+	if (command_errors() != lastRxErrors) {
+		flags |= HEALTH_FLAG_RX_ERROR;
+	}
+	return flags;
+}
+
+/* Clear flags that were sent */
+void health_clear_flags(uint16_t flags)
+{
+	if (flags & HEALTH_FLAG_OVERFLOW) {
+		lastOverflows = capture_overflows();
+	}
+	if (flags & HEALTH_FLAG_TX_DROPPED) {
+		lastTxDropped = vcom_tx_dropped();
+	}
+	if (flags & HEALTH_FLAG_RX_ERROR) {
+		lastRxErrors = command_errors();
+	}
+
+	/* enter critical section */
+	NVIC_DisableIRQ(DMA_IRQn);
+	pendingFlags &= ~flags;
+	/* exit critical section */
+	NVIC_EnableIRQ(DMA_IRQn);
+}
+
+/* Get the number of ADC overruns */
+uint32_t health_adc_overruns(void)
+{
+	return adcOverruns;
+}
+
+/* Get the number of DMA errors */
+uint32_t health_dma_errors(void)
+{
+	return dmaErrors;
+}
+
+/* Get the worst block interval jitter */
+uint32_t health_block_jitter_max(void)
+{
+	return blockJitterMax;
+}
@@ -0,0 +1,71 @@
+/*
+ * @brief Device identification
+ *
+ * @note
+ * Chip_IAP_ReadUID() only returns the first UID word, the full ID is read
+ * with the same IAP command. The serial number string is the UID in hex,
+ * first word first, most significant nibble first.
+ */
+#include "board.h"
+#include "iap.h"
+#include "app_usbd_cfg.h"
+#include "ident.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t uid[IDENT_UID_WORDS];
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Find a string in the string descriptor array */
+static uint8_t *ident_find_string(uint32_t index)
+{
+	uint8_t *pD = USB_StringDescriptor;
+
+	while (index > 0 && pD[0] != 0) {
+		pD += pD[0];
+		index--;
+	}
+	return pD;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Read the unique ID and put it in the USB serial number string */
+void ident_init(void)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	/* Status word followed by the four UID words */
+	unsigned int command[5], result[1 + IDENT_UID_WORDS];
+	uint8_t *pStr;
+	uint32_t i;
+
+	command[0] = IAP_READ_UID_CMD;
+	iap_entry(command, result);
+	for (i = 0; i < IDENT_UID_WORDS; i++) {
+		uid[i] = (result[0] == IAP_CMD_SUCCESS) ? result[1 + i] : 0;
+	}
+
+	/* Unicode characters follow bLength and bDescriptorType */
+	pStr = ident_find_string(USB_SERIAL_STRING_IDX) + 2;
+	for (i = 0; i < USB_SERIAL_STRING_LEN; i++) {
+		pStr[2 * i] = hex[(uid[i / 8] >> (28 - 4 * (i % 8))) & 0xF];
+		pStr[2 * i + 1] = 0;
+	}
+}
+
+/* Get the unique ID */
+const uint32_t *ident_get_uid(void)
+{
+	return uid;
+}
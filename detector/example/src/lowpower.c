@@ -0,0 +1,129 @@
+/*
+ * @brief Idle power management
+ *
+ * @note
+ * Deep-sleep stops the main clock, so the core runs from the IRC while the
+ * PLLs are down and switches back once they lock again after wake-up. The
+ * USB need_clock signal wakes the chip when the host resumes the bus. The
+ * StopWatch tick does not advance during deep-sleep.
+ */
+#include "board.h"
+#include "cdc_vcom.h"
+#include "measure.h"
+#include "lowpower.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Peripherals off until a driver enables them, the rest are never used */
+static const CHIP_SYSCTL_CLOCK_T unusedClocks[] = {
+	SYSCTL_CLOCK_I2C0, SYSCTL_CLOCK_I2C1, SYSCTL_CLOCK_SSP0, SYSCTL_CLOCK_SSP1,
+	SYSCTL_CLOCK_UART0, SYSCTL_CLOCK_USART1, SYSCTL_CLOCK_USART2,
+	SYSCTL_CLOCK_USART3_4, SYSCTL_CLOCK_CT16B0, SYSCTL_CLOCK_CT16B1,
+	SYSCTL_CLOCK_WDT, SYSCTL_CLOCK_PINT, SYSCTL_CLOCK_GROUP0INT,
+	SYSCTL_CLOCK_GROUP1INT, SYSCTL_CLOCK_RTC, SYSCTL_CLOCK_SCT0_1,
+};
+
+static volatile bool usbSuspended;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Deep-sleep until the host resumes the bus */
+static void lowpower_deep_sleep(void)
+{
+	/* need_clock only drops a few ms after the suspend event */
+	if (Chip_SYSCTL_GetUSBCLKStatus()) {
+		Chip_PMU_SleepState(LPC_PMU);
+		return;
+	}
+
+	/* Run from the IRC, the PLLs are powered down */
+	Chip_Clock_SetMainClockSource(SYSCTL_MAINCLKSRC_IRC);
+
+	/* Power everything up again on wake-up, BOD and watchdog oscillator off
+	   while asleep */
+	Chip_SYSCTL_SetDeepSleepPD(SYSCTL_DEEPSLP_BOD_PD | SYSCTL_DEEPSLP_WDTOSC_PD);
+	Chip_SYSCTL_SetWakeup(Chip_SYSCTL_GetPowerStates());
+
+	/* Wake up on the rising edge of need_clock */
+	Chip_SYSCTL_SetUSBCLKCTRL(0, 1);
+	Chip_SYSCTL_EnablePeriphWakeup(SYSCTL_WAKEUP_USB_WAKEUP);
+	NVIC_ClearPendingIRQ(USB_WAKEUP_IRQn);
+	NVIC_EnableIRQ(USB_WAKEUP_IRQn);
+
+	/* A resume just before the WFI leaves its interrupt pending, which
+	   still ends the sleep with interrupts masked */
+	__disable_irq();
+	if (usbSuspended) {
+		Chip_PMU_Sleep(LPC_PMU, PMU_MCU_DEEP_SLEEP);
+	}
+	__enable_irq();
+
+	NVIC_DisableIRQ(USB_WAKEUP_IRQn);
+	Chip_SYSCTL_DisablePeriphWakeup(SYSCTL_WAKEUP_USB_WAKEUP);
+	SCB->SCR &= ~(1UL << SCB_SCR_SLEEPDEEP_Pos);
+
+	while (!Chip_Clock_IsSystemPLLLocked()) {}
+	while (!Chip_Clock_IsUSBPLLLocked()) {}
+	Chip_Clock_SetMainClockSource(SYSCTL_MAINCLKSRC_PLLOUT);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/**
+ * @brief	Handle USB wake-up interrupt
+ * @return	Nothing
+ * @note	Only used to leave deep-sleep, the USB interrupt handles the resume.
+ */
+void USBWakeup_IRQHandler(void)
+{
+	NVIC_DisableIRQ(USB_WAKEUP_IRQn);
+}
+
+/* Gate the clocks of unused peripherals */
+void lowpower_init(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < sizeof(unusedClocks) / sizeof(unusedClocks[0]); i++) {
+		Chip_Clock_DisablePeriphClock(unusedClocks[i]);
+	}
+	Chip_SYSCTL_PowerDown(SYSCTL_POWERDOWN_TS_PD | SYSCTL_POWERDOWN_WDTOSC_PD);
+}
+
+/* USB suspend event handler */
+ErrorCode_t lowpower_usb_suspend(USBD_HANDLE_T hUsb)
+{
+	usbSuspended = true;
+	return LPC_OK;
+}
+
+/* USB resume event handler */
+ErrorCode_t lowpower_usb_resume(USBD_HANDLE_T hUsb)
+{
+	usbSuspended = false;
+	return LPC_OK;
+}
+
+/* Wait for the next interrupt in the deepest safe state */
+void lowpower_idle(void)
+{
+	/* No conversions while nobody takes the results */
+	measure_suspend(usbSuspended || !vcom_connected());
+
+	if (usbSuspended) {
+		lowpower_deep_sleep();
+	}
+	else {
+		Chip_PMU_SleepState(LPC_PMU);
+	}
+}
@@ -0,0 +1,591 @@
+/*
+ * @brief Measurement control
+ *
+ * @note
+ * Each captured block is reduced into an output frame as soon as it is
+ * available, so the DMA block is released right away. The output frame is
+ * held until the stream accepts it.
+ */
+#include "board.h"
+#include "stopwatch.h"
+#include "sampler.h"
+#include "capture.h"
+#include "filter.h"
+#include "stats.h"
+#include "burst.h"
+#include "power.h"
+#include "stream.h"
+#include "health.h"
+#include "extrig.h"
+#include "sequencer.h"
+#include "sweep.h"
+#include "encode.h"
+#include "usbsync.h"
+#include "measure.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t mode;
+static bool streaming;
+static bool suspended;
+static bool powerOutput;
+
+/* T_ADJ switch log, conversions before tadjMaskEnd are dropped */
+static bool tadjAuto;
+static uint32_t tadjTick;
+static uint32_t tadjSwitches;
+static bool tadjMasking;
+static uint32_t tadjMaskEnd;
+
+/* Results waiting for room in the TX queue */
+static union {
+	uint16_t samples[CAPTURE_BLOCK_MAX];
+	int16_t power[CAPTURE_BLOCK_MAX];
+	STATS_RECORD_T stats[CAPTURE_BLOCK_MAX / STATS_MIN_WINDOW + 1];
+	BURST_FRAME_T burst;
+	SWEEP_FRAME_T sweep;
+} outBuf;
+static uint8_t outType;
+static uint32_t outCount;
+static uint32_t outLen;
+static uint32_t outTick;
+static uint32_t outIndex;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Wait for the next external trigger with fresh capture blocks */
+static void measure_rearm(void)
+{
+	/* Fewest blocks of equal size that hold the averaged conversions */
+	uint32_t n = filter_get_average();
+	uint32_t blocks = (n + CAPTURE_BLOCK_MAX - 1) / CAPTURE_BLOCK_MAX;
+
+	sampler_run(false);
+	filter_reset();
+	capture_start_blocks((n + blocks - 1) / blocks, blocks);
+	extrig_arm();
+}
+
+/* Drive the T_ADJ pin, returns true if the setting changed */
+static bool measure_switch_tadj(bool high)
+{
+	if (high == measure_get_tadj()) {
+		return false;
+	}
+	Chip_GPIO_SetPinState(LPC_GPIO, BOARD_TADJ_PORT, BOARD_TADJ_PIN, high);
+
+	tadjTick = StopWatch_Start();
+	tadjMaskEnd = tadjTick + StopWatch_UsToTicks(MEASURE_TADJ_SETTLE);
+	tadjMasking = true;
+	tadjSwitches++;
+
+	return true;
+}
+
+/* Number of leading conversions in a block taken while T_ADJ settled */
+static uint32_t measure_masked(uint32_t len, uint32_t tick)
+{
+	int32_t after = (int32_t) (tick - tadjMaskEnd);
+	uint32_t valid;
+
+	if (!tadjMasking) {
+		return 0;
+	}
+	if (after < 0) {
+		return len;
+	}
+
+	/* Conversions are evenly spaced up to the last one at the block tick */
+	valid = after / sampler_period_ticks() + 1;
+	if (valid >= len) {
+		tadjMasking = false;
+		return 0;
+	}
+	return len - valid;
+}
+
+/* Apply the next sweep point and start its sequencer step */
+static void measure_sweep_point(void)
+{
+	const SWEEP_POINT_T *pt;
+	uint32_t settle;
+	bool high;
+
+	while ((pt = sweep_point()) != NULL) {
+		/* A T_ADJ switch is covered by the settle time of the point */
+		high = tadjAuto ? pt->freq >= MEASURE_TADJ_FREQ : pt->tadj != 0;
+		settle = pt->settle;
+		if (measure_switch_tadj(high) && settle < MEASURE_TADJ_SETTLE) {
+			settle = MEASURE_TADJ_SETTLE;
+		}
+		power_set_frequency(pt->freq);
+		if (sequencer_setup(settle, pt->samples, 1)) {
+			break;
+		}
+		sweep_process(NULL, 0, StopWatch_Start(), powerOutput);
+	}
+	if (pt == NULL) {
+		return;
+	}
+
+	/* One block per point */
+	capture_start(pt->samples);
+	if (sweep_get_flags() & SWEEP_FLAG_EXTERNAL) {
+		extrig_arm_sequencer();
+	}
+	else {
+		sequencer_start();
+	}
+}
+
+/* Restart capture with blocks sized for the current rate */
+static void measure_restart(void)
+{
+	bool running = streaming && !suspended;
+
+	outCount = 0;
+	filter_reset();
+	stats_reset();
+	if (running && mode == MEASURE_MODE_BURST) {
+		burst_arm();
+	}
+	else {
+		burst_disarm();
+	}
+	extrig_disarm();
+	sequencer_stop();
+	sweep_stop();
+	sampler_run(false);
+	sampler_set_sct_trigger(running && (mode == MEASURE_MODE_SEQUENCE ||
+										mode == MEASURE_MODE_SWEEP));
+
+	/* Only the own sample clock gives blocks at a fixed rate */
+	capture_set_free_running(mode != MEASURE_MODE_EXTERNAL && mode != MEASURE_MODE_SEQUENCE &&
+							 mode != MEASURE_MODE_SWEEP &&
+							 sampler_get_sync() != SAMPLER_SYNC_SLAVE);
+
+	/* USB frame numbers are only sent with the stream */
+	usbsync_enable(running);
+
+	/* Conversions only run while somebody takes the results */
+	if (!running) {
+		capture_stop();
+	}
+	else if (mode == MEASURE_MODE_EXTERNAL) {
+		measure_rearm();
+	}
+	else if (mode == MEASURE_MODE_SEQUENCE) {
+		/* One block per step, stamped at its last conversion */
+		capture_start(sequencer_samples());
+		sequencer_start();
+	}
+	else if (mode == MEASURE_MODE_SWEEP) {
+		sweep_start();
+		measure_sweep_point();
+	}
+	else {
+		capture_start(sampler_get_rate() / CAPTURE_BLOCK_RATE);
+		sampler_run(true);
+	}
+}
+
+/* Send the pending output frame, returns false if it is still pending */
+static bool measure_flush(void)
+{
+	if (outCount > 0) {
+		if (!stream_send(outType, outCount, outTick, outIndex, &outBuf, outLen)) {
+			return false;
+		}
+		outCount = 0;
+	}
+	return true;
+}
+
+/* Burst mode, capture never waits for the upload */
+static void measure_poll_burst(void)
+{
+	const uint32_t *block;
+
+	while ((block = capture_get_block()) != NULL) {
+		health_check_block(block, capture_block_len());
+		burst_process(block, capture_block_len(), capture_block_tick());
+		capture_release_block();
+	}
+
+	if (measure_flush()) {
+		outCount = burst_read(&outBuf.burst, &outTick);
+		if (outCount > 0) {
+			outType = STREAM_TYPE_BURST;
+			outIndex = 0;
+			outLen = sizeof(BURST_HDR_T) + outCount * sizeof(uint16_t);
+			measure_flush();
+		}
+	}
+}
+
+/* External trigger mode, the edge starts the conversions */
+static void measure_poll_external(void)
+{
+	const uint32_t *block;
+
+	if (!measure_flush()) {
+		return;
+	}
+
+	while ((block = capture_get_block()) != NULL) {
+		health_check_block(block, capture_block_len());
+		outCount = filter_process(block, capture_block_len(), outBuf.samples);
+		capture_release_block();
+		if (outCount > 0) {
+			/* Later conversions of the last block are not used */
+			outCount = 1;
+			outTick = extrig_tick();
+			outIndex = 0;
+			outType = STREAM_TYPE_SAMPLES;
+			outLen = sizeof(uint16_t);
+			if (powerOutput) {
+				outType = STREAM_TYPE_POWER;
+				power_convert(outBuf.samples, outBuf.power, outCount);
+			}
+			measure_rearm();
+			measure_flush();
+			return;
+		}
+	}
+}
+
+/* Sweep mode, one block per point and the results after the last one */
+static void measure_poll_sweep(void)
+{
+	const uint32_t *block;
+	bool last;
+
+	if (!measure_flush()) {
+		return;
+	}
+
+	if ((block = capture_get_block()) != NULL) {
+		health_check_block(block, capture_block_len());
+		sweep_process(block, capture_block_len(), capture_block_tick(), powerOutput);
+		capture_release_block();
+		measure_sweep_point();
+	}
+
+	outCount = sweep_read(&outBuf.sweep, &outTick);
+	if (outCount > 0) {
+		outType = STREAM_TYPE_SWEEP;
+		outIndex = 0;
+		outLen = sizeof(SWEEP_HDR_T) + outCount * sizeof(uint16_t);
+
+		/* The flush clears outCount once the piece is sent */
+		last = outBuf.sweep.hdr.offset + outCount == outBuf.sweep.hdr.total;
+		measure_flush();
+
+		/* A repeating sweep starts over after its last piece */
+		if (last) {
+			measure_sweep_point();
+		}
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialize sampling, capture and the T_ADJ output */
+void measure_init(void)
+{
+	/* Configure T_ADJ(PIO0_16) pin as output, it follows the frequency */
+	Chip_GPIO_SetPinDIROutput(LPC_GPIO, BOARD_TADJ_PORT, BOARD_TADJ_PIN);
+	Chip_GPIO_SetPinState(LPC_GPIO, BOARD_TADJ_PORT, BOARD_TADJ_PIN, false);
+	tadjAuto = true;
+
+	/* Setup ADC, sampling is paced by a hardware timer and results are
+	   moved to RAM by DMA */
+	capture_init();
+	sampler_init();
+	extrig_init();
+	sequencer_init();
+	filter_set_average(1);
+	stats_set_window(STATS_DEFAULT_WINDOW);
+	burst_setup(BURST_DEFAULT_LEVEL, false, BURST_DEFAULT_PRE, BURST_DEFAULT_POST);
+	measure_set_frequency(POWER_DEFAULT_FREQ);
+
+	mode = MEASURE_MODE_STREAM;
+	streaming = true;
+	measure_restart();
+}
+
+/* Set the ADC sample rate */
+uint32_t measure_set_rate(uint32_t rate)
+{
+	rate = sampler_set_rate(rate);
+	measure_restart();
+
+	return rate;
+}
+
+/* Select the ADC acquisition profile */
+uint32_t measure_set_profile(uint32_t profile)
+{
+	uint32_t rate = sampler_set_profile(profile);
+
+	measure_restart();
+
+	return rate;
+}
+
+/* Set the number of conversions averaged per output sample */
+uint32_t measure_set_average(uint32_t n)
+{
+	n = filter_set_average(n);
+	measure_restart();
+
+	return n;
+}
+
+/* Set the IIR smoother time constant */
+uint32_t measure_set_smoothing(uint32_t shift)
+{
+	shift = filter_set_smoothing(shift);
+	measure_restart();
+
+	return shift;
+}
+
+/* Set the statistics window length */
+uint32_t measure_set_window(uint32_t n)
+{
+	n = stats_set_window(n);
+	measure_restart();
+
+	return n;
+}
+
+/* Configure the burst trigger */
+bool measure_set_trigger(uint16_t level, bool falling, uint32_t pre, uint32_t post)
+{
+	if (!burst_setup(level, falling, pre, post)) {
+		return false;
+	}
+	measure_restart();
+
+	return true;
+}
+
+/* Configure the external trigger */
+bool measure_set_ext_trigger(bool falling, uint32_t settle)
+{
+	if (!extrig_setup(falling, settle)) {
+		return false;
+	}
+	measure_restart();
+
+	return true;
+}
+
+/* Set the sequencer timeline */
+bool measure_set_sequence(uint32_t settle, uint32_t samples, uint32_t steps)
+{
+	if (!sequencer_setup(settle, samples, steps)) {
+		return false;
+	}
+	measure_restart();
+
+	return true;
+}
+
+/* Store a sweep list */
+bool measure_load_sweep(const uint8_t *list, uint32_t len)
+{
+	if (!sweep_load(list, len)) {
+		return false;
+	}
+	measure_restart();
+
+	return true;
+}
+
+/* Select the sample clock sync role */
+bool measure_set_sync(uint32_t role)
+{
+	if (role >= SAMPLER_SYNC_COUNT) {
+		return false;
+	}
+	sampler_run(false);
+	sampler_set_sync(role);
+	measure_restart();
+
+	return true;
+}
+
+/* Select sample or power output */
+void measure_set_power_output(bool enable)
+{
+	powerOutput = enable;
+	measure_restart();
+}
+
+/* Check for power output */
+bool measure_is_power_output(void)
+{
+	return powerOutput;
+}
+
+/* Select the T_ADJ resistor */
+void measure_set_tadj(bool high)
+{
+	tadjAuto = false;
+	measure_switch_tadj(high);
+}
+
+/* Select the T_ADJ resistor from the operating frequency */
+void measure_set_tadj_auto(void)
+{
+	tadjAuto = true;
+	measure_switch_tadj(power_get_frequency() >= MEASURE_TADJ_FREQ);
+}
+
+/* Check for automatic T_ADJ selection */
+bool measure_is_tadj_auto(void)
+{
+	return tadjAuto;
+}
+
+/* Get the time of the last T_ADJ switch */
+uint32_t measure_tadj_tick(void)
+{
+	return tadjTick;
+}
+
+/* Get the number of T_ADJ switches */
+uint32_t measure_tadj_switches(void)
+{
+	return tadjSwitches;
+}
+
+/* Set the operating frequency */
+void measure_set_frequency(uint32_t freq)
+{
+	power_set_frequency(freq);
+	if (tadjAuto) {
+		measure_switch_tadj(freq >= MEASURE_TADJ_FREQ);
+	}
+}
+
+/* Get the T_ADJ resistor selection */
+bool measure_get_tadj(void)
+{
+	return Chip_GPIO_GetPinState(LPC_GPIO, BOARD_TADJ_PORT, BOARD_TADJ_PIN);
+}
+
+/* Start or stop sending results */
+void measure_set_streaming(bool enable)
+{
+	streaming = enable;
+	measure_restart();
+}
+
+/* Check if results are being sent */
+bool measure_is_streaming(void)
+{
+	return streaming;
+}
+
+/* Suspend or resume acquisition */
+void measure_suspend(bool suspend)
+{
+	if (suspend != suspended) {
+		suspended = suspend;
+		measure_restart();
+	}
+}
+
+/* Select the measurement mode */
+bool measure_set_mode(uint32_t newMode)
+{
+	if (newMode >= MEASURE_MODE_COUNT) {
+		return false;
+	}
+	mode = newMode;
+	measure_restart();
+
+	return true;
+}
+
+/* Get the measurement mode */
+uint32_t measure_get_mode(void)
+{
+	return mode;
+}
+
+/* Process captured blocks and send results */
+void measure_poll(void)
+{
+	const uint32_t *block;
+	uint32_t skip, len;
+
+	if (mode == MEASURE_MODE_BURST) {
+		measure_poll_burst();
+		return;
+	}
+	if (mode == MEASURE_MODE_EXTERNAL) {
+		measure_poll_external();
+		return;
+	}
+	if (mode == MEASURE_MODE_SWEEP) {
+		measure_poll_sweep();
+		return;
+	}
+
+	/* Retry results the TX queue had no room for */
+	if (!measure_flush()) {
+		return;
+	}
+
+	if ((block = capture_get_block()) == NULL) {
+		return;
+	}
+
+	health_check_block(block, capture_block_len());
+
+	/* Results are stamped with the completion of the block they came from */
+	outTick = capture_block_tick();
+	outIndex = capture_block_index();
+	skip = measure_masked(capture_block_len(), outTick);
+	len = capture_block_len() - skip;
+	switch (mode) {
+	case MEASURE_MODE_STATS:
+		outType = STREAM_TYPE_STATS;
+		outCount = stats_process(block + skip, len, outBuf.stats,
+								 sizeof(outBuf.stats) / sizeof(outBuf.stats[0]));
+		outLen = outCount * sizeof(STATS_RECORD_T);
+		break;
+
+	default:
+		outType = STREAM_TYPE_SAMPLES;
+		outCount = filter_process(block + skip, len, outBuf.samples);
+		outLen = outCount * sizeof(uint16_t);
+		if (powerOutput) {
+			outType = STREAM_TYPE_POWER;
+			power_convert(outBuf.samples, outBuf.power, outCount);
+		}
+		else if ((len = encode_samples(outBuf.samples, outCount, (uint8_t *) outBuf.samples)) > 0) {
+			/* Encoded in place, count stays the number of samples */
+			outType = encode_get_mode() == ENCODE_PACK12 ? STREAM_TYPE_PACKED : STREAM_TYPE_DELTA;
+			outLen = len;
+		}
+		break;
+	}
+	capture_release_block();
+
+	measure_flush();
+}
@@ -0,0 +1,123 @@
+/*
+ * @brief Detector voltage to power conversion
+ *
+ * @note
+ * The band weight is the only division and is computed when the frequency
+ * changes. The offset is folded into the active table. Results are clamped
+ * to the int16_t range.
+ */
+#include "board.h"
+#include "power.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define POWER_WEIGHT_SHIFT      12
+
+static const POWER_BAND_T *bandTable = power_default_bands;
+static uint32_t bandCount = POWER_DEFAULT_BANDS;
+static uint32_t frequency = POWER_DEFAULT_FREQ;
+static int32_t powerOffset;
+
+/* Table for the current frequency */
+static int16_t activeLut[POWER_LUT_POINTS];
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static int16_t power_clamp(int32_t y)
+{
+	if (y > 32767) {
+		return 32767;
+	}
+	if (y < -32768) {
+		return -32768;
+	}
+	return y;
+}
+
+/* Blend the two bands nearest to the current frequency */
+static void power_build_lut(void)
+{
+	const POWER_BAND_T *lo, *hi;
+	int32_t w;
+	uint32_t i;
+
+	if (bandCount == 1) {
+		for (i = 0; i < POWER_LUT_POINTS; i++) {
+			activeLut[i] = power_clamp(bandTable[0].dbm[i] + powerOffset);
+		}
+		return;
+	}
+
+	/* Pick the bracketing pair, or the outermost pair to extrapolate */
+	for (i = 1; i < bandCount - 1; i++) {
+		if (frequency < bandTable[i].freq) {
+			break;
+		}
+	}
+	lo = &bandTable[i - 1];
+	hi = &bandTable[i];
+	w = (((int32_t) frequency - lo->freq) << POWER_WEIGHT_SHIFT) / (hi->freq - lo->freq);
+
+	for (i = 0; i < POWER_LUT_POINTS; i++) {
+		activeLut[i] = power_clamp(lo->dbm[i] + powerOffset +
+								   (((hi->dbm[i] - lo->dbm[i]) * w) >> POWER_WEIGHT_SHIFT));
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Select the calibration bands */
+void power_set_bands(const POWER_BAND_T *bands, uint32_t num)
+{
+	bandTable = bands;
+	bandCount = num;
+	power_build_lut();
+}
+
+/* Set a power offset added to every band */
+void power_set_offset(int32_t offset)
+{
+	powerOffset = offset;
+	power_build_lut();
+}
+
+/* Set the operating frequency */
+void power_set_frequency(uint32_t freq)
+{
+	if (freq > POWER_MAX_FREQ) {
+		freq = POWER_MAX_FREQ;
+	}
+	frequency = freq;
+	power_build_lut();
+}
+
+/* Get the operating frequency */
+uint32_t power_get_frequency(void)
+{
+	return frequency;
+}
+
+/* Convert samples to power */
+void power_convert(const uint16_t *in, int16_t *out, uint32_t len)
+{
+	uint32_t i, x, idx, frac;
+	int32_t y0;
+
+	for (i = 0; i < len; i++) {
+		x = in[i];
+		idx = x >> POWER_LUT_SHIFT;
+		frac = x & ((1 << POWER_LUT_SHIFT) - 1);
+		y0 = activeLut[idx];
+		out[i] = y0 + (((activeLut[idx + 1] - y0) * (int32_t) frac) >> POWER_LUT_SHIFT);
+	}
+}
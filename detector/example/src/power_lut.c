@@ -0,0 +1,125 @@
+/*
+ * @brief Default AD8319 calibration tables
+ *
+ * @note
+ * Generated by cal_lut.py from ad8319cal.py, do not edit.
+ */
+#include "board.h"
+#include "power.h"
+
+const POWER_BAND_T power_default_bands[POWER_DEFAULT_BANDS] = {
+	{900, {
+		32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767,
+		28604, 23487, 18370, 13252, 8135, 3018, 702, 395,
+		137, -21, -178, -321, -437, -552, -667, -783,
+		-898, -1013, -1129, -1244, -1360, -1475, -1590, -1706,
+		-1821, -1937, -2052, -2167, -2283, -2398, -2513, -2629,
+		-2744, -2860, -2975, -3090, -3206, -3321, -3436, -3552,
+		-3667, -3783, -3898, -4013, -4129, -4244, -4360, -4523,
+		-4696, -4887, -5144, -5485, -5965, -6445, -6925, -7405,
+		-7885, -8365, -8845, -9325, -9804, -10284, -10764, -11244,
+		-11724, -12204, -12684, -13164, -13644, -14124, -14604, -15084,
+		-15564, -16044, -16524, -17004, -17484, -17964, -18444, -18924,
+		-19404, -19884, -20364, -20844, -21324, -21804, -22284, -22764,
+		-23244, -23724, -24204, -24684, -25164, -25644, -26124, -26604,
+		-27084, -27564, -28044, -28524, -29004, -29484, -29964, -30444,
+		-30924, -31404, -31884, -32364, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768,
+	}},
+	{1900, {
+		11764, 10934, 10104, 9274, 8444, 7615, 6785, 5955,
+		5125, 4295, 3466, 2636, 1806, 976, 334, 76,
+		-85, -245, -377, -494, -611, -727, -844, -961,
+		-1078, -1195, -1311, -1428, -1545, -1662, -1778, -1895,
+		-2012, -2129, -2245, -2362, -2479, -2596, -2713, -2829,
+		-2946, -3063, -3180, -3296, -3413, -3530, -3647, -3764,
+		-3880, -3997, -4114, -4231, -4349, -4474, -4599, -4724,
+		-4874, -5090, -5355, -5687, -6019, -6351, -6683, -7015,
+		-7347, -7679, -8011, -8343, -8675, -9007, -9338, -9670,
+		-10002, -10334, -10666, -10998, -11330, -11662, -11994, -12326,
+		-12658, -12990, -13321, -13653, -13985, -14317, -14649, -14981,
+		-15313, -15645, -15977, -16309, -16641, -16973, -17304, -17636,
+		-17968, -18300, -18632, -18964, -19296, -19628, -19960, -20292,
+		-20624, -20956, -21288, -21619, -21951, -22283, -22615, -22947,
+		-23279, -23611, -23943, -24275, -24607, -24939, -25271, -25602,
+		-25934, -26266, -26598, -26930, -27262, -27594, -27926, -28258,
+		-28590,
+	}},
+	{2200, {
+		7141, 6660, 6178, 5696, 5215, 4733, 4251, 3769,
+		3288, 2806, 2324, 1843, 1361, 879, 398, 132,
+		-82, -242, -403, -521, -638, -755, -873, -990,
+		-1107, -1224, -1341, -1459, -1576, -1693, -1810, -1927,
+		-2045, -2162, -2279, -2396, -2514, -2631, -2748, -2865,
+		-2982, -3100, -3217, -3334, -3451, -3568, -3686, -3803,
+		-3920, -4037, -4154, -4272, -4389, -4506, -4629, -4754,
+		-4878, -5082, -5351, -5748, -6146, -6543, -6941, -7338,
+		-7735, -8133, -8530, -8928, -9325, -9722, -10120, -10517,
+		-10915, -11312, -11709, -12107, -12504, -12902, -13299, -13696,
+		-14094, -14491, -14889, -15286, -15683, -16081, -16478, -16876,
+		-17273, -17670, -18068, -18465, -18862, -19260, -19657, -20055,
+		-20452, -20849, -21247, -21644, -22042, -22439, -22836, -23234,
+		-23631, -24029, -24426, -24823, -25221, -25618, -26016, -26413,
+		-26810, -27208, -27605, -28003, -28400, -28797, -29195, -29592,
+		-29990, -30387, -30784, -31182, -31579, -31977, -32374, -32768,
+		-32768,
+	}},
+	{3600, {
+		10789, 9998, 9207, 8415, 7624, 6833, 6041, 5250,
+		4459, 3667, 2876, 2085, 1294, 502, -12, -242,
+		-392, -541, -677, -790, -903, -1016, -1129, -1242,
+		-1355, -1468, -1581, -1694, -1807, -1920, -2033, -2146,
+		-2259, -2372, -2485, -2598, -2711, -2824, -2937, -3050,
+		-3163, -3276, -3389, -3502, -3615, -3728, -3841, -3954,
+		-4067, -4180, -4292, -4402, -4511, -4621, -4730, -4859,
+		-5029, -5199, -5449, -5808, -6168, -6528, -6887, -7247,
+		-7606, -7966, -8325, -8685, -9045, -9404, -9764, -10123,
+		-10483, -10842, -11202, -11561, -11921, -12281, -12640, -13000,
+		-13359, -13719, -14078, -14438, -14798, -15157, -15517, -15876,
+		-16236, -16595, -16955, -17314, -17674, -18034, -18393, -18753,
+		-19112, -19472, -19831, -20191, -20551, -20910, -21270, -21629,
+		-21989, -22348, -22708, -23067, -23427, -23787, -24146, -24506,
+		-24865, -25225, -25584, -25944, -26304, -26663, -27023, -27382,
+		-27742, -28101, -28461, -28820, -29180, -29540, -29899, -30259,
+		-30618,
+	}},
+	{5800, {
+		13467, 12572, 11677, 10782, 9887, 8992, 8097, 7202,
+		6307, 5412, 4517, 3622, 2728, 1833, 938, 330,
+		141, 5, -117, -233, -349, -465, -581, -697,
+		-813, -929, -1045, -1161, -1277, -1392, -1508, -1624,
+		-1740, -1856, -1972, -2088, -2204, -2320, -2436, -2552,
+		-2668, -2784, -2900, -3016, -3132, -3248, -3364, -3480,
+		-3596, -3714, -3840, -3965, -4091, -4216, -4342, -4467,
+		-4606, -4761, -4981, -5342, -6083, -6825, -7567, -8308,
+		-9050, -9792, -10533, -11275, -12017, -12758, -13500, -14242,
+		-14983, -15725, -16467, -17208, -17950, -18692, -19433, -20175,
+		-20917, -21658, -22400, -23142, -23883, -24625, -25367, -26108,
+		-26850, -27592, -28333, -29075, -29816, -30558, -31300, -32041,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768,
+	}},
+	{8000, {
+		3167, 3029, 2890, 2752, 2614, 2475, 2337, 2199,
+		2061, 1922, 1784, 1646, 1507, 1369, 1231, 1092,
+		954, 727, 425, 119, -4, -127, -230, -332,
+		-435, -538, -640, -756, -871, -987, -1103, -1219,
+		-1335, -1451, -1567, -1683, -1798, -1914, -2030, -2146,
+		-2262, -2378, -2494, -2609, -2725, -2841, -2957, -3073,
+		-3189, -3305, -3420, -3536, -3652, -3768, -3921, -4095,
+		-4270, -4477, -4720, -5236, -6363, -7517, -8672, -9826,
+		-10981, -12135, -13290, -14444, -15599, -16753, -17908, -19062,
+		-20217, -21371, -22526, -23680, -24835, -25989, -27144, -28298,
+		-29453, -30607, -31762, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+		-32768,
+	}},
+};
@@ -0,0 +1,332 @@
+/*
+ * @brief Hardware timed ADC sample clock
+ *
+ * @note
+ * CT32B0 runs from the system clock and toggles MAT0 on every match. The ADC
+ * sequencer triggers on the rising edge of MAT0, so the match period is half
+ * of the sample period. In burst mode the sequencer restarts as soon as a
+ * conversion completes and the timer is stopped. A sync master routes MAT0
+ * to a pin, a slave triggers on the CT16B0 CAP0 input and leaves its timer
+ * stopped, so all detectors convert on the same edges.
+ */
+#include "board.h"
+#include "stopwatch.h"
+#include "sampler.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define SAMPLER_TIMER           LPC_TIMER32_0
+#define SAMPLER_MATCH           0
+
+static uint32_t sampleRate;
+static uint32_t profile;
+static uint32_t syncRole;
+static bool sctTrigger;
+static volatile bool thresholdCrossed;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Setup CT32B0 so that MAT0 toggles and the counter restarts on match */
+static void sampler_timer_init(void)
+{
+	Chip_TIMER_Init(SAMPLER_TIMER);
+	Chip_TIMER_Disable(SAMPLER_TIMER);
+	Chip_TIMER_Reset(SAMPLER_TIMER);
+	Chip_TIMER_PrescaleSet(SAMPLER_TIMER, 0);
+	Chip_TIMER_ResetOnMatchEnable(SAMPLER_TIMER, SAMPLER_MATCH);
+	Chip_TIMER_ExtMatchControlSet(SAMPLER_TIMER, 0, TIMER_EXTMATCH_TOGGLE, SAMPLER_MATCH);
+}
+
+/* Program the sequence A trigger for the selected source */
+static void sampler_select_trigger(void)
+{
+	uint32_t ctrl, trig;
+
+	if (sctTrigger) {
+		trig = ADC_SEQ_CTRL_HWTRIG_SCT_OUT0;
+	}
+	else if (syncRole == SAMPLER_SYNC_SLAVE) {
+		trig = ADC_SEQ_CTRL_HWTRIG_CT16B0_CAP0;
+	}
+	else {
+		trig = ADC_SEQ_CTRL_HWTRIG_CT32B0_MAT0;
+	}
+
+	/* Trigger source may only change with the sequencer stopped */
+	Chip_ADC_DisableSequencer(LPC_ADC, ADC_SEQA_IDX);
+	ctrl = LPC_ADC->SEQ_CTRL[ADC_SEQA_IDX] & ~(ADC_SEQ_CTRL_HWTRIG_MASK | ADC_SEQ_CTRL_SEQ_ENA);
+	LPC_ADC->SEQ_CTRL[ADC_SEQA_IDX] = ctrl | trig;
+	Chip_ADC_EnableSequencer(LPC_ADC, ADC_SEQA_IDX);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/**
+ * @brief	Handle threshold interrupt from ADC
+ * @return	Nothing
+ */
+void ADCB_IRQHandler(void)
+{
+	uint32_t pending = Chip_ADC_GetFlags(LPC_ADC);
+
+	/* Threshold crossing interrupt on ADC input channel, one shot */
+	if (pending & ADC_FLAGS_THCMP_MASK(BOARD_ADC_CH)) {
+		Chip_ADC_SetThresholdInt(LPC_ADC, BOARD_ADC_CH, ADC_INTEN_THCMP_DISABLE);
+		thresholdCrossed = true;
+	}
+
+	/* Leave the sequence A flag alone, it is the DMA request */
+	Chip_ADC_ClearFlags(LPC_ADC, pending & ADC_FLAGS_THCMP_MASK(BOARD_ADC_CH));
+}
+
+/* Initialize the ADC and its sample clock timer */
+void sampler_init(void)
+{
+	/* Setup ADC for 12-bit mode and normal power */
+	Chip_ADC_Init(LPC_ADC, 0);
+
+	/* Need to do a calibration after initialization and trim */
+	Chip_ADC_StartCalibration(LPC_ADC);
+	while (!(Chip_ADC_IsCalibrationDone(LPC_ADC))) {}
+
+	/* Setup ADC clock rate using sycnchronous clocking */
+	Chip_ADC_SetClockRate(LPC_ADC, SAMPLER_ADC_CLOCK);
+
+	/* Setup a sequencer to do the following:
+	   Perform ADC conversion of ADC channel 1 only on the rising edge
+	   of CT32B0 MAT0. End of conversion mode, so the sequence interrupt
+	   is cleared by the DMA read of SEQA_GDAT. */
+	Chip_ADC_SetupSequencer(LPC_ADC, ADC_SEQA_IDX,
+		(ADC_SEQ_CTRL_CHANSEL(BOARD_ADC_CH) | ADC_SEQ_CTRL_HWTRIG_CT32B0_MAT0 |
+		 ADC_SEQ_CTRL_HWTRIG_POLPOS));
+
+	/* ADC input 1 is on PIO0_23 mapped to FUNC1 */
+	Chip_IOCON_PinMuxSet(LPC_IOCON, 0, 23, (IOCON_FUNC1 | IOCON_MODE_INACT |
+										   IOCON_ADMODE_EN));
+	/* Use higher voltage trim */
+	Chip_ADC_SetTrim(LPC_ADC, ADC_TRIM_VRANGE_HIGHV);
+
+	/* Clear all pending interrupts */
+	Chip_ADC_ClearFlags(LPC_ADC, Chip_ADC_GetFlags(LPC_ADC));
+
+	/* Enable sequence A completion interrupt. It is the DMA trigger and is
+	   not enabled in the NVIC. Overruns are flagged in each result. */
+	Chip_ADC_EnableInt(LPC_ADC, ADC_INTEN_SEQA_ENABLE);
+
+	/* Threshold 0 is compared against every result, the crossing
+	   interrupt is enabled when armed */
+	Chip_ADC_SelectTH0Channels(LPC_ADC, ADC_THRSEL_CHAN_SEL_THR1(BOARD_ADC_CH));
+	NVIC_EnableIRQ(ADC_B_IRQn);
+
+	/* Enable sequencer */
+	Chip_ADC_EnableSequencer(LPC_ADC, ADC_SEQA_IDX);
+
+	sampler_timer_init();
+	sampler_set_rate(SAMPLER_DEFAULT_RATE);
+}
+
+/* Select the acquisition profile */
+uint32_t sampler_set_profile(uint32_t newProfile)
+{
+	uint32_t ctrl;
+
+	/* Burst conversions would not follow the master clock */
+	if (syncRole == SAMPLER_SYNC_SLAVE) {
+		newProfile &= ~SAMPLER_PROFILE_BURST;
+	}
+	if (newProfile & SAMPLER_PROFILE_BURST) {
+		newProfile |= SAMPLER_PROFILE_FAST;
+	}
+	profile = newProfile & SAMPLER_PROFILE_MASK;
+
+	/* Control register may only change with the sequencer stopped */
+	Chip_TIMER_Disable(SAMPLER_TIMER);
+	Chip_ADC_StopBurstSequencer(LPC_ADC, ADC_SEQA_IDX);
+	Chip_ADC_DisableSequencer(LPC_ADC, ADC_SEQA_IDX);
+
+	ctrl = LPC_ADC->CTRL & ~ADC_CR_MODE10BIT;
+	if (profile & SAMPLER_PROFILE_10BIT) {
+		ctrl |= ADC_CR_MODE10BIT;
+	}
+	LPC_ADC->CTRL = ctrl;
+	Chip_ADC_SetClockRate(LPC_ADC, (profile & SAMPLER_PROFILE_FAST) ?
+						  SAMPLER_FAST_ADC_CLOCK : SAMPLER_ADC_CLOCK);
+
+	Chip_ADC_EnableSequencer(LPC_ADC, ADC_SEQA_IDX);
+	if (profile & SAMPLER_PROFILE_BURST) {
+		sampleRate = sampler_max_rate();
+		Chip_ADC_StartBurstSequencer(LPC_ADC, ADC_SEQA_IDX);
+		return sampleRate;
+	}
+
+	return sampler_set_rate(sampleRate);
+}
+
+/* Get the acquisition profile */
+uint32_t sampler_get_profile(void)
+{
+	return profile;
+}
+
+/* Set the ADC sample rate */
+uint32_t sampler_set_rate(uint32_t rate)
+{
+	uint32_t clk = Chip_Clock_GetSystemClockRate();
+	uint32_t half;
+
+	/* Rate is set by the conversion time */
+	if (profile & SAMPLER_PROFILE_BURST) {
+		return sampleRate;
+	}
+
+	if (rate < SAMPLER_MIN_RATE) {
+		rate = SAMPLER_MIN_RATE;
+	}
+	else if (rate > sampler_max_rate()) {
+		rate = sampler_max_rate();
+	}
+
+	/* Two matches per sample, MAT0 toggles on each of them */
+	half = clk / (2 * rate);
+	if (half == 0) {
+		half = 1;
+	}
+	if (clk / (2 * half) > sampler_max_rate()) {
+		half++;
+	}
+
+	Chip_TIMER_Disable(SAMPLER_TIMER);
+	Chip_TIMER_SetMatch(SAMPLER_TIMER, SAMPLER_MATCH, half - 1);
+	Chip_TIMER_Reset(SAMPLER_TIMER);
+	Chip_TIMER_Enable(SAMPLER_TIMER);
+
+	sampleRate = clk / (2 * half);
+	return sampleRate;
+}
+
+/* Start or stop conversions */
+void sampler_run(bool enable)
+{
+	if (profile & SAMPLER_PROFILE_BURST) {
+		if (enable) {
+			Chip_ADC_StartBurstSequencer(LPC_ADC, ADC_SEQA_IDX);
+		}
+		else {
+			Chip_ADC_StopBurstSequencer(LPC_ADC, ADC_SEQA_IDX);
+		}
+	}
+	else if (enable) {
+		/* A slave converts on the master clock */
+		if (syncRole != SAMPLER_SYNC_SLAVE) {
+			Chip_TIMER_Reset(SAMPLER_TIMER);
+			Chip_TIMER_Enable(SAMPLER_TIMER);
+		}
+	}
+	else {
+		Chip_TIMER_Disable(SAMPLER_TIMER);
+	}
+
+	/* Let a conversion that was already triggered finish */
+	if (!enable) {
+		StopWatch_DelayTicks(StopWatch_TicksPerSecond() / sampler_max_rate() + 1);
+	}
+}
+
+/* Select the conversion trigger */
+void sampler_set_sct_trigger(bool enable)
+{
+	sctTrigger = enable;
+	sampler_select_trigger();
+}
+
+/* Select the sample clock sync role */
+bool sampler_set_sync(uint32_t role)
+{
+	if (role >= SAMPLER_SYNC_COUNT) {
+		return false;
+	}
+	syncRole = role;
+
+	/* The sync output is U0_RXD unless this is the master, the unused
+	   sync input is left as after reset */
+	Chip_IOCON_PinMuxSet(LPC_IOCON, SAMPLER_SYNC_OUT_PORT, SAMPLER_SYNC_OUT_PIN,
+						 ((role == SAMPLER_SYNC_MASTER ? SAMPLER_SYNC_OUT_FUNC : IOCON_FUNC1) |
+						  IOCON_MODE_INACT | IOCON_DIGMODE_EN));
+	if (role == SAMPLER_SYNC_SLAVE) {
+		/* An unconnected input must not trigger */
+		Chip_IOCON_PinMuxSet(LPC_IOCON, SAMPLER_SYNC_IN_PORT, SAMPLER_SYNC_IN_PIN,
+							 (SAMPLER_SYNC_IN_FUNC | IOCON_MODE_PULLDOWN | IOCON_DIGMODE_EN));
+	}
+	else {
+		Chip_IOCON_PinMuxSet(LPC_IOCON, SAMPLER_SYNC_IN_PORT, SAMPLER_SYNC_IN_PIN,
+							 (IOCON_FUNC0 | IOCON_MODE_PULLUP | IOCON_DIGMODE_EN));
+	}
+
+	if (role == SAMPLER_SYNC_SLAVE && (profile & SAMPLER_PROFILE_BURST)) {
+		sampler_set_profile(profile);
+	}
+	sampler_select_trigger();
+
+	return true;
+}
+
+/* Get the sample clock sync role */
+uint32_t sampler_get_sync(void)
+{
+	return syncRole;
+}
+
+/* Get the current ADC sample rate */
+uint32_t sampler_get_rate(void)
+{
+	return sampleRate;
+}
+
+/* Get the sample period in StopWatch ticks */
+uint32_t sampler_period_ticks(void)
+{
+	return StopWatch_TicksPerSecond() / sampleRate;
+}
+
+/* Get the fastest sample rate the converter supports */
+uint32_t sampler_max_rate(void)
+{
+	uint32_t adcClk = Chip_Clock_GetSystemClockRate() / (Chip_ADC_GetDivider(LPC_ADC) + 1);
+
+	return adcClk / SAMPLER_CONV_CLOCKS;
+}
+
+/* Arm the threshold crossing interrupt */
+void sampler_arm_threshold(uint16_t level)
+{
+	Chip_ADC_SetThresholdInt(LPC_ADC, BOARD_ADC_CH, ADC_INTEN_THCMP_DISABLE);
+	Chip_ADC_SetThrLowValue(LPC_ADC, 0, level);
+	Chip_ADC_SetThrHighValue(LPC_ADC, 0, level);
+	Chip_ADC_ClearFlags(LPC_ADC, ADC_FLAGS_THCMP_MASK(BOARD_ADC_CH));
+
+	thresholdCrossed = false;
+	Chip_ADC_SetThresholdInt(LPC_ADC, BOARD_ADC_CH, ADC_INTEN_THCMP_CROSSING);
+}
+
+/* Disable the threshold crossing interrupt */
+void sampler_disarm_threshold(void)
+{
+	Chip_ADC_SetThresholdInt(LPC_ADC, BOARD_ADC_CH, ADC_INTEN_THCMP_DISABLE);
+	thresholdCrossed = false;
+}
+
+/* Check for a threshold crossing since the last arm */
+bool sampler_threshold_crossed(void)
+{
+	return thresholdCrossed;
+}
@@ -0,0 +1,242 @@
+/*
+ * @brief SCT measurement sequencer
+ *
+ * @note
+ * SCT0 is split into two 16-bit counters. The H counter runs the timeline
+ * in two states, settle and dwell, each ended by a limit event. The L
+ * counter is started at the end of the settle time and makes one rising
+ * edge on OUT0 per sample period, the first one right at the start of the
+ * dwell window. The dwell window ends half a sample period after the last
+ * conversion, so prescaler phase can not add or drop a conversion.
+ */
+#include "board.h"
+#include "sampler.h"
+#include "capture.h"
+#include "sequencer.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define SEQ_SCT                 LPC_SCT0
+#define SEQ_ADC_OUT             0		/* SCT0_OUT0, ADC hardware trigger */
+
+/* Event control register fields */
+#define SEQ_EV_MATCHSEL(n)      ((n) << 0)
+#define SEQ_EV_HEVENT           (1 << 4)
+#define SEQ_EV_COMBMODE_MATCH   (1 << 12)
+#define SEQ_EV_STATELD          (1 << 14)
+#define SEQ_EV_STATEV(n)        ((n) << 15)
+
+/* H counter states */
+#define SEQ_STATE_SETTLE        0
+#define SEQ_STATE_DWELL         1
+
+/* Events, settle and dwell end on the H counter, sample clock on the L counter */
+#define SEQ_EVT_SETTLE          SCT_EVT_0
+#define SEQ_EVT_DWELL           SCT_EVT_1
+#define SEQ_EVT_HALF            SCT_EVT_2
+#define SEQ_EVT_PERIOD          SCT_EVT_3
+
+static uint32_t settleTime;
+static uint32_t stepSamples;
+static uint32_t stepCount;
+static volatile uint32_t stepsDone;
+
+/* Counter setup and the sample rate it was made for */
+static uint32_t preL;
+static uint32_t preH;
+static uint32_t timingRate;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Set both halves of a match register and its reload value */
+static void sequencer_set_match(uint32_t n, uint32_t low, uint32_t high)
+{
+	SEQ_SCT->MATCH[n].U = low | (high << 16);
+	SEQ_SCT->MATCHREL[n].U = low | (high << 16);
+}
+
+/* Program the match values for the sampler rate, false if they do not fit */
+static bool sequencer_timing(uint32_t settle, uint32_t samples)
+{
+	uint32_t clk = Chip_Clock_GetSystemClockRate();
+	uint32_t period = clk / sampler_get_rate();
+	uint32_t countL, settleClk, dwellClk, countSettle, countDwell;
+
+	timingRate = 0;
+
+	/* Sample clock, exact period in bus clocks */
+	preL = (period - 1) / 65536;
+	countL = period / (preL + 1);
+	period = countL * (preL + 1);
+
+	if (period > 0xFFFFFFFF / samples) {
+		return false;
+	}
+
+	/* Timeline at the finest resolution that holds the longest interval */
+	settleClk = settle * (clk / 1000000);
+	dwellClk = samples * period - period / 2;
+	preH = ((settleClk > dwellClk ? settleClk : dwellClk) - 1) / 65536;
+	if (preH > 0xFF) {
+		return false;
+	}
+
+	/* The end of the dwell window may move by a timeline tick and must stay
+	   clear of the sample edges */
+	if (period < 4 * (preH + 1)) {
+		return false;
+	}
+
+	countSettle = settleClk / (preH + 1);
+	if (countSettle == 0) {
+		countSettle = 1;
+	}
+	countDwell = (dwellClk + (preH + 1) / 2) / (preH + 1);
+
+	sequencer_set_match(0, countL - 1, countSettle - 1);
+	sequencer_set_match(1, countL / 2 - 1, countDwell - 1);
+	timingRate = sampler_get_rate();
+
+	return true;
+}
+
+/* Halt both counters with the outputs low */
+static void sequencer_halt(void)
+{
+	Chip_SCT_SetControl(SEQ_SCT, SCT_CTRL_HALT_L | SCT_CTRL_HALT_H);
+	SEQ_SCT->OUTPUT = 0;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/**
+ * @brief	Handle interrupt from SCT
+ * @return	Nothing
+ */
+void SCT0_1_IRQHandler(void)
+{
+	Chip_SCT_ClearEventFlag(SEQ_SCT, SEQ_EVT_DWELL);
+
+	/* The next step has already started settling */
+	stepsDone++;
+	if (stepCount != 0 && stepsDone >= stepCount) {
+		sequencer_halt();
+	}
+}
+
+/* Initialize the SCT and the sync output */
+void sequencer_init(void)
+{
+	Chip_SCT_Init(SEQ_SCT);
+	Chip_SCT_Config(SEQ_SCT, SCT_CONFIG_16BIT_COUNTER | SCT_CONFIG_CLKMODE_BUSCLK);
+	sequencer_halt();
+
+	/* End of settle, start the sample clock with the first ADC trigger */
+	SEQ_SCT->EVENT[0].STATE = 1 << SEQ_STATE_SETTLE;
+	SEQ_SCT->EVENT[0].CTRL = SEQ_EV_MATCHSEL(0) | SEQ_EV_HEVENT | SEQ_EV_COMBMODE_MATCH |
+							 SEQ_EV_STATELD | SEQ_EV_STATEV(SEQ_STATE_DWELL);
+
+	/* End of dwell, stop and clear the sample clock and start the next step */
+	SEQ_SCT->EVENT[1].STATE = 1 << SEQ_STATE_DWELL;
+	SEQ_SCT->EVENT[1].CTRL = SEQ_EV_MATCHSEL(1) | SEQ_EV_HEVENT | SEQ_EV_COMBMODE_MATCH |
+							 SEQ_EV_STATELD | SEQ_EV_STATEV(SEQ_STATE_SETTLE);
+
+	/* Sample clock, OUT0 falls half way and rises at the end of each period */
+	SEQ_SCT->EVENT[2].STATE = 1;
+	SEQ_SCT->EVENT[2].CTRL = SEQ_EV_MATCHSEL(1) | SEQ_EV_COMBMODE_MATCH;
+	SEQ_SCT->EVENT[3].STATE = 1;
+	SEQ_SCT->EVENT[3].CTRL = SEQ_EV_MATCHSEL(0) | SEQ_EV_COMBMODE_MATCH;
+
+	SEQ_SCT->LIMIT_H = SEQ_EVT_SETTLE | SEQ_EVT_DWELL;
+	SEQ_SCT->LIMIT_L = SEQ_EVT_DWELL | SEQ_EVT_PERIOD;
+	SEQ_SCT->START_L = SEQ_EVT_SETTLE;
+	SEQ_SCT->STOP_L = SEQ_EVT_DWELL;
+
+	SEQ_SCT->OUT[SEQ_ADC_OUT].SET = SEQ_EVT_SETTLE | SEQ_EVT_PERIOD;
+	SEQ_SCT->OUT[SEQ_ADC_OUT].CLR = SEQ_EVT_DWELL | SEQ_EVT_HALF;
+	SEQ_SCT->OUT[SEQUENCER_SYNC_OUT].SET = SEQ_EVT_DWELL;
+	SEQ_SCT->OUT[SEQUENCER_SYNC_OUT].CLR = SEQ_EVT_SETTLE;
+
+	/* A period edge at the end of the dwell window must not trigger */
+	Chip_SCT_SetConflictResolution(SEQ_SCT, SEQ_ADC_OUT, SCT_RES_CLEAR_OUTPUT);
+
+	Chip_IOCON_PinMuxSet(LPC_IOCON, SEQUENCER_SYNC_PORT, SEQUENCER_SYNC_PIN,
+						 (SEQUENCER_SYNC_FUNC | IOCON_MODE_INACT | IOCON_DIGMODE_EN));
+
+	Chip_SCT_EnableEventInt(SEQ_SCT, SEQ_EVT_DWELL);
+	NVIC_EnableIRQ(SCT0_1_IRQn);
+
+	sequencer_setup(SEQUENCER_DEFAULT_SETTLE, 1, 0);
+}
+
+/* Set the step timeline */
+bool sequencer_setup(uint32_t settle, uint32_t samples, uint32_t steps)
+{
+	if (settle > SEQUENCER_MAX_SETTLE || samples == 0 || samples > CAPTURE_BLOCK_MAX) {
+		return false;
+	}
+
+	sequencer_stop();
+	if (!sequencer_timing(settle, samples)) {
+		return false;
+	}
+	settleTime = settle;
+	stepSamples = samples;
+	stepCount = steps;
+
+	return true;
+}
+
+/* Start the timeline from the first step */
+bool sequencer_start(void)
+{
+	sequencer_stop();
+
+	/* The sample rate may have changed since the setup */
+	if (sampler_get_rate() != timingRate && !sequencer_timing(settleTime, stepSamples)) {
+		return false;
+	}
+	stepsDone = 0;
+
+	/* First step settles with the sync output high, the L counter waits
+	   for the end of the settle time */
+	SEQ_SCT->STATE_H = SEQ_STATE_SETTLE;
+	SEQ_SCT->OUTPUT = 1 << SEQUENCER_SYNC_OUT;
+	SEQ_SCT->CTRL_U = SCT_CTRL_STOP_L | SCT_CTRL_CLRCTR_L | SCT_CTRL_PRE_L(preL) |
+					  SCT_CTRL_CLRCTR_H | SCT_CTRL_PRE_H(preH);
+
+	return true;
+}
+
+/* Stop the timeline */
+void sequencer_stop(void)
+{
+	/* enter critical section */
+	NVIC_DisableIRQ(SCT0_1_IRQn);
+	sequencer_halt();
+	Chip_SCT_ClearEventFlag(SEQ_SCT, SEQ_EVT_DWELL);
+	/* exit critical section */
+	NVIC_EnableIRQ(SCT0_1_IRQn);
+}
+
+/* Get the number of conversions per step */
+uint32_t sequencer_samples(void)
+{
+	return stepSamples;
+}
+
+/* Get the number of completed steps */
+uint32_t sequencer_steps_done(void)
+{
+	return stepsDone;
+}
@@ -0,0 +1,48 @@
+/*
+ * @brief Single-producer/single-consumer ring
+ *
+ * @note
+ * The counters are 32-bit and wrap, their difference stays correct as long
+ * as the ring holds fewer than 2^32 items. The loads and stores of a
+ * counter are single instructions, the barrier in spsc_commit() and
+ * spsc_release() orders them against the item data.
+ */
+#include "board.h"
+#include "spsc.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialize a ring */
+bool spsc_init(SPSC_RING_T *ring, void *buffer, uint32_t itemSize, uint32_t count)
+{
+	if (count == 0 || (count & (count - 1)) != 0) {
+		return false;
+	}
+	ring->data = buffer;
+	ring->itemSize = itemSize;
+	ring->mask = count - 1;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return true;
+}
+
+/* Discard all items, consumer side */
+void spsc_flush(SPSC_RING_T *ring)
+{
+	spsc_release(ring, spsc_count(ring));
+}
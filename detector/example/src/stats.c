@@ -0,0 +1,128 @@
+/*
+ * @brief Per-window sample statistics
+ *
+ * @note
+ * The per-conversion work is a compare, an add and a multiply-accumulate.
+ * The sum of squares needs 64 bits for long windows. Mean and RMS are only
+ * computed when a window completes.
+ */
+#include "board.h"
+#include "filter.h"
+#include "stats.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static uint32_t window = STATS_DEFAULT_WINDOW;
+static uint32_t accCount;
+static uint32_t accMin;
+static uint32_t accMax;
+static uint32_t accSum;
+static uint64_t accSumSq;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Integer square root, rounded down */
+static uint32_t stats_isqrt(uint32_t x)
+{
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > x) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		}
+		else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
+
+/* Reduce the accumulated window to a record */
+static void stats_finish(STATS_RECORD_T *rec)
+{
+	uint64_t ms;
+
+	rec->count = accCount;
+	rec->min = accMin;
+	rec->max = accMax;
+	rec->mean = (((uint64_t) accSum << FILTER_FRAC_BITS) + accCount / 2) / accCount;
+
+	/* Mean square with 2 * FILTER_FRAC_BITS fractional bits */
+	ms = (accSumSq << (2 * FILTER_FRAC_BITS)) / accCount;
+	rec->rms = stats_isqrt(ms > 0xFFFFFFFFUL ? 0xFFFFFFFFUL : ms);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Discard the partially accumulated window */
+void stats_reset(void)
+{
+	accCount = 0;
+	accMin = 0xFFFFFFFFUL;
+	accMax = 0;
+	accSum = 0;
+	accSumSq = 0;
+}
+
+/* Set the window length */
+uint32_t stats_set_window(uint32_t n)
+{
+	if (n < STATS_MIN_WINDOW) {
+		n = STATS_MIN_WINDOW;
+	}
+	else if (n > STATS_MAX_WINDOW) {
+		n = STATS_MAX_WINDOW;
+	}
+	window = n;
+	stats_reset();
+
+	return window;
+}
+
+/* Get the window length */
+uint32_t stats_get_window(void)
+{
+	return window;
+}
+
+/* Accumulate raw ADC results */
+uint32_t stats_process(const uint32_t *raw, uint32_t len, STATS_RECORD_T *rec, uint32_t maxRec)
+{
+	uint32_t i, x, cnt = 0;
+
+	for (i = 0; i < len; i++) {
+		x = ADC_DR_RESULT(raw[i]);
+		if (x < accMin) {
+			accMin = x;
+		}
+		if (x > accMax) {
+			accMax = x;
+		}
+		accSum += x;
+		accSumSq += x * x;
+
+		if (++accCount == window) {
+			if (cnt < maxRec) {
+				stats_finish(&rec[cnt++]);
+			}
+			stats_reset();
+		}
+	}
+	return cnt;
+}
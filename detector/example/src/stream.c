@@ -0,0 +1,101 @@
+/*
+ * @brief Sample stream framing
+ *
+ * @note
+ * Frames are built in place in a single buffer and queued to the VCOM
+ * driver in one write. The CRC is computed by the CRC engine in CRC-16
+ * mode, fed one byte at a time so the host sees plain CRC-16/ARC over the
+ * byte stream regardless of how the engine orders wider writes.
+ */
+#include <string.h>
+#include "board.h"
+#include "cdc_vcom.h"
+#include "health.h"
+#include "stream.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/**
+ * Frame buffer, header followed by the payload
+ */
+typedef struct STREAM_FRAME {
+	STREAM_HDR_T hdr;
+	uint8_t payload[STREAM_MAX_PAYLOAD];
+} STREAM_FRAME_T;
+
+static STREAM_FRAME_T frame;
+static uint16_t seq;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Initialize frame sequencing and the CRC engine */
+void stream_init(void)
+{
+	Chip_CRC_Init();
+	seq = 0;
+}
+
+/* Send a frame */
+bool stream_send(uint8_t type, uint16_t count, uint32_t tick, uint32_t index,
+				 const void *payload, uint32_t len)
+{
+	uint32_t size = sizeof(STREAM_HDR_T) + len;
+	uint16_t flags;
+
+	if (len > STREAM_MAX_PAYLOAD) {
+		return false;
+	}
+
+	/* Back-pressure, only sequence frames that will be sent */
+	if (vcom_tx_free() < (size + USB_FS_MAX_BULK_PACKET - 1) / USB_FS_MAX_BULK_PACKET) {
+		return false;
+	}
+
+	frame.hdr.sync = STREAM_SYNC;
+	frame.hdr.version = STREAM_VERSION;
+	frame.hdr.type = type;
+	frame.hdr.seq = seq;
+	frame.hdr.len = len;
+	frame.hdr.tick = tick;
+	frame.hdr.count = count;
+	frame.hdr.flags = flags = health_get_flags();
+	frame.hdr.index = index;
+	frame.hdr.crc = 0;
+	if (len > 0) {
+		memcpy(frame.payload, payload, len);
+	}
+	frame.hdr.crc = stream_crc16(&frame, size);
+
+	if (vcom_write((uint8_t *) &frame, size) == 0) {
+		return false;
+	}
+	seq++;
+	health_clear_flags(flags);
+	return true;
+}
+
+/* Compute the CRC used by frames and commands */
+uint16_t stream_crc16(const void *data, uint32_t len)
+{
+	const uint8_t *p = data;
+
+	Chip_CRC_UseCRC16();
+	while (len > 0) {
+		Chip_CRC_Write8(*p);
+		p++;
+		len--;
+	}
+	return Chip_CRC_Sum();
+}
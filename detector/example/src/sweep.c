@@ -0,0 +1,178 @@
+/*
+ * @brief On-device sweep list
+ *
+ * @note
+ * The sweep only keeps the list and the results, measure.c applies each
+ * point and runs the sequencer. Results are averaged like the decimator
+ * output, with FILTER_FRAC_BITS fractional bits, and the smoother is not
+ * applied.
+ */
+#include <string.h>
+#include "board.h"
+#include "capture.h"
+#include "filter.h"
+#include "power.h"
+#include "sweep.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+typedef enum SWEEP_STATE {
+	SWEEP_IDLE,
+	SWEEP_RUNNING,			/* Measuring the points */
+	SWEEP_READY,			/* All points done, being read out */
+} SWEEP_STATE_T;
+
+static SWEEP_POINT_T points[SWEEP_MAX_POINTS];
+static uint32_t numPoints;
+static uint32_t listFlags;
+
+static SWEEP_STATE_T state;
+static uint16_t results[SWEEP_MAX_POINTS];
+static uint32_t resultFlags;
+static uint32_t current;
+static uint32_t sweepTick;
+static uint32_t readOffset;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Store a sweep list */
+bool sweep_load(const uint8_t *list, uint32_t len)
+{
+	SWEEP_LIST_HDR_T hdr;
+	SWEEP_POINT_T pt;
+	uint32_t i, num;
+
+	if (len < sizeof(hdr) || (len - sizeof(hdr)) % sizeof(pt) != 0) {
+		return false;
+	}
+	num = (len - sizeof(hdr)) / sizeof(pt);
+	if (num > SWEEP_MAX_POINTS) {
+		return false;
+	}
+
+	/* Command payload is not aligned */
+	for (i = 0; i < num; i++) {
+		memcpy(&pt, &list[sizeof(hdr) + i * sizeof(pt)], sizeof(pt));
+		if (pt.samples == 0 || pt.samples > CAPTURE_BLOCK_MAX || pt.freq > POWER_MAX_FREQ) {
+			return false;
+		}
+	}
+
+	sweep_stop();
+	memcpy(&hdr, list, sizeof(hdr));
+	memcpy(points, &list[sizeof(hdr)], num * sizeof(pt));
+	numPoints = num;
+	listFlags = hdr.flags & (SWEEP_FLAG_EXTERNAL | SWEEP_FLAG_REPEAT);
+
+	return true;
+}
+
+/* Get the flags of the sweep list */
+uint32_t sweep_get_flags(void)
+{
+	return listFlags;
+}
+
+/* Start the sweep from the first point */
+void sweep_start(void)
+{
+	current = 0;
+	resultFlags = listFlags;
+	state = numPoints > 0 ? SWEEP_RUNNING : SWEEP_IDLE;
+}
+
+/* Stop the sweep and discard its results */
+void sweep_stop(void)
+{
+	state = SWEEP_IDLE;
+}
+
+/* Get the point to measure next */
+const SWEEP_POINT_T *sweep_point(void)
+{
+	if (state != SWEEP_RUNNING) {
+		return NULL;
+	}
+	return &points[current];
+}
+
+/* Store the result of the point from sweep_point() */
+void sweep_process(const uint32_t *raw, uint32_t len, uint32_t tick, bool power)
+{
+	uint32_t i, sum = 0;
+	uint16_t x;
+	int16_t p;
+
+	if (state != SWEEP_RUNNING) {
+		return;
+	}
+
+	if (raw == NULL || len == 0) {
+		x = power ? (uint16_t) SWEEP_INVALID_POWER : SWEEP_INVALID_SAMPLE;
+	}
+	else {
+		for (i = 0; i < len; i++) {
+			sum += ADC_DR_RESULT(raw[i]);
+		}
+		x = ((sum << FILTER_FRAC_BITS) + len / 2) / len;
+		if (power) {
+			power_convert(&x, &p, 1);
+			x = (uint16_t) p;
+		}
+	}
+
+	/* All results of a sweep are of one kind */
+	if (power) {
+		resultFlags |= SWEEP_FLAG_POWER;
+	}
+	results[current] = x;
+	sweepTick = tick;
+
+	if (++current == numPoints) {
+		readOffset = 0;
+		state = SWEEP_READY;
+	}
+}
+
+/* Read the next piece of a completed sweep */
+uint32_t sweep_read(SWEEP_FRAME_T *frm, uint32_t *tick)
+{
+	uint32_t cnt;
+
+	if (state != SWEEP_READY) {
+		return 0;
+	}
+
+	cnt = numPoints - readOffset;
+	if (cnt > SWEEP_FRAME_POINTS) {
+		cnt = SWEEP_FRAME_POINTS;
+	}
+	frm->hdr.offset = readOffset;
+	frm->hdr.total = numPoints;
+	frm->hdr.flags = resultFlags;
+	*tick = sweepTick;
+	memcpy(frm->results, &results[readOffset], cnt * sizeof(uint16_t));
+
+	readOffset += cnt;
+	if (readOffset == numPoints) {
+		if (listFlags & SWEEP_FLAG_REPEAT) {
+			sweep_start();
+		}
+		else {
+			state = SWEEP_IDLE;
+		}
+	}
+	return cnt;
+}
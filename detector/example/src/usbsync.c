@@ -0,0 +1,99 @@
+/*
+ * @brief USB start-of-frame time reference
+ *
+ * @note
+ * The tick is latched at the start of the USB interrupt, so it trails the
+ * SOF by the interrupt latency only. A pair is sent late rather than
+ * dropped when the TX queue is full, it still maps the frame to its tick.
+ */
+#include "board.h"
+#include "stopwatch.h"
+#include "stream.h"
+#include "usbsync.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+static volatile uint32_t sofTick;
+static volatile uint16_t sofFrame;
+static volatile uint32_t sofCount;
+static uint32_t sentCount;
+
+static USBD_HANDLE_T hUsbSync;
+static bool sofEnabled;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Apply the SOF interrupt setting to the USB stack */
+static void usbsync_apply(void)
+{
+	if (hUsbSync == NULL) {
+		return;
+	}
+
+	/* enter critical section */
+	NVIC_DisableIRQ(USB0_IRQn);
+	USBD_API->hw->EnableEvent(hUsbSync, 0, USB_EVT_SOF, sofEnabled);
+	/* Only frames latched from now on are sent */
+	sentCount = sofCount;
+	/* exit critical section */
+	NVIC_EnableIRQ(USB0_IRQn);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Set the USB stack used for the SOF interrupt */
+void usbsync_init(USBD_HANDLE_T hUsb)
+{
+	hUsbSync = hUsb;
+	usbsync_apply();
+}
+
+/* Enable or disable the SOF interrupt */
+void usbsync_enable(bool enable)
+{
+	if (enable != sofEnabled) {
+		sofEnabled = enable;
+		usbsync_apply();
+	}
+}
+
+/* Latch the device tick and frame number of a SOF */
+void usbsync_sof(void)
+{
+	sofTick = StopWatch_Start();
+	sofFrame = LPC_USB->INFO & USBSYNC_FRAME_NR_MASK;
+	sofCount++;
+}
+
+/* Send the latest frame number and its tick */
+void usbsync_poll(void)
+{
+	uint32_t tick, count;
+	uint16_t frame;
+
+	if (sofCount - sentCount < USBSYNC_INTERVAL) {
+		return;
+	}
+
+	/* enter critical section */
+	NVIC_DisableIRQ(USB0_IRQn);
+	tick = sofTick;
+	frame = sofFrame;
+	count = sofCount;
+	/* exit critical section */
+	NVIC_EnableIRQ(USB0_IRQn);
+
+	if (stream_send(STREAM_TYPE_SOF, 1, tick, 0, &frame, sizeof(frame))) {
+		sentCount = count;
+	}
+}
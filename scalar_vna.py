@@ -8,19 +8,18 @@ lo_set = False
 lo_pll = MAX2871(2)
 source_pll = MAX2871(3)
 
-def measure(sers, device, freqs, apwr=1):
+#Measure detector sample clock wired to the reference, PIO0_18 to PIO0_2
+shared_clock = False
+
+def measure(sensors, device, freqs, apwr=1):
+    """sensors is a list of (Detector, (luts, offset)), reference first."""
     global lo_set
     real_freqs = []
     samples = []
     for freq in freqs:
-        #Set T_ADJ
-        #for ser in sers:
-        #    if freq >= 5.3e9:
-        #        #500 ohm if f > 5.3 GHz
-        #        ser.write('\xf1')
-        #    else:
-        #        #8.2k if f < 5.3 GHz
-        #        ser.write('\xf0')
+        #Detectors select T_ADJ from the frequency
+        for reader, cal in sensors:
+            reader.set_frequency(freq)
 
         source_freq = freq
         ref_freq = 19.2e6
@@ -42,23 +41,18 @@ def measure(sers, device, freqs, apwr=1):
         #print source_power(device, source_freq)
 
         ps = [None, None]
-        for e,ser in enumerate(sers):
-            ser.reset_input_buffer()
-            while True:
-                try:
-                    x = ord(ser.read(1))
-                    if x != 0xFF:
-                        continue
-                    x = map(ord,ser.read(2))
-                    if x[0] & 0xF0 != 0x00:
-                        #Not synchronized, try again
-                        continue
-                    y = ((x[0] & 0x0F) << 8) | x[1]
-                    ps[e] = (v_to_dbm(3.3*y/4095.0, freq))
-                except KeyboardInterrupt:
-                    print "Exiting"
-                    break
-                break
+        if shared_clock:
+            #Both detectors sampled at the same instants
+            for reader, cal in sensors:
+                reader.reset()
+            frames = read_aligned([reader for reader, cal in sensors])
+            for e, (frame, (reader, (luts, offset))) in enumerate(zip(frames, sensors)):
+                ps[e] = calib_to_dbm(luts, offset, np.mean(frame.samples()), freq)
+        else:
+            for e,(reader, (luts, offset)) in enumerate(sensors):
+                reader.reset()
+                y = np.mean(reader.read_samples())
+                ps[e] = calib_to_dbm(luts, offset, y, freq)
         print ps[1]-ps[0],ps[0],ps[1]
         samples.append(ps[1]-ps[0])
     return real_freqs, samples
@@ -82,31 +76,28 @@ if __name__ == "__main__":
     select_mixer_input(device, 'rx1')
     select_port(device, 2)
 
-    sers = []
-    ports = serial.tools.list_ports.comports()
-    for dev, name, desc in ports:
-        if 'VID:PID=1FC9:0083' in desc:
-            try:
-                ser = serial.Serial(
-                    port=dev,
-                    baudrate=1e6,
-                    parity=serial.PARITY_NONE,
-                    stopbits=serial.STOPBITS_TWO,
-                    bytesize=serial.EIGHTBITS,
-                    timeout=0.1
-                )
-                if not ser.isOpen():
-                    raise Exception
-                sers.append(ser)
-            except:
-                print 'Opening serial port {} failed.'.format(dev)
-                raise
-    if len(sers) < 2:
-        raise Exception("Unable to find power detectors. Found {}.".format(len(sers)))
+    #Same sensor gets the same role on every run, see sensors.json
+    registry = Registry()
+    found = registry.assign(find_detectors(), ('reference', 'measure'))
+    if len(found) < 2:
+        raise Exception("Unable to find power detectors. Found {}.".format(len(found)))
+    sensors = []
+    for role in ('reference', 'measure'):
+        det, status = found[role]
+        print '{}: {}'.format(role, status['uid'])
+        sensors.append((det, registry.calibration(det, status)))
+
+    if shared_clock:
+        ref, meas = sensors[0][0], sensors[1][0]
+        ref.set_streaming(False)
+        meas.set_sample_rate(ref.status()['rate'])
+        meas.set_sync(SYNC_SLAVE)
+        ref.set_sync(SYNC_MASTER)
+        ref.set_streaming(True)
 
     freqs = np.linspace(100e6, 5.999e9, 600)
     try:
-        real_freqs, samples = measure(sers, device, freqs)
+        real_freqs, samples = measure(sensors, device, freqs)
         print np.mean(samples)
 
         with open('response.p', 'w') as f: